@@ -0,0 +1,267 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+// End-to-end benchmark on synthetic random (3, 6)-regular codes of several sizes: graph construction,
+// alist parsing, syndrome mat-vec, single-shot decode latency and batched decode throughput.
+// Prints one JSON document, or writes it to the path given as the second argument.
+#include <string>
+#include <random>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+
+#include "nlohmann/json.hpp"
+
+#include "bp_decoder/bp_decoder.hpp"
+#include "bp_decoder/batch_bp_decoder.hpp"
+#include "sparse_matrix/sparse_matrix.hpp"
+#include "sparse_matrix/mod2_vector.hpp"
+
+using ::std::operator""sv;
+using Clock = ::std::chrono::steady_clock;
+using Index = ::sparse_matrix::Mod2SparseMatrix::Index;
+
+static constexpr int col_weight{3}, row_weight{6}, max_iter{50};
+static constexpr size_t batch_lanes{16};
+
+static double nanoseconds(Clock::time_point start, Clock::time_point end)
+{
+    return ::std::chrono::duration<double, ::std::nano>(end - start).count();
+}
+
+// CSR arrays of a random regular code from the configuration model: column sockets are shuffled and dealt
+// out to the rows. Repeated entries within a row cancel mod 2 and are dropped.
+struct Csr
+{
+    size_t rows, cols;
+    ::std::vector<Index> row_offsets, edge_cols;
+};
+static Csr randomRegularCode(size_t cols, ::std::mt19937_64 &rand_example)
+{
+    Csr csr{cols * col_weight / row_weight, cols, {0}, {}};
+    ::std::vector<Index> sockets(cols * col_weight);
+    for (auto s{0ULL}; s < sockets.size(); s++)
+        sockets[s] = static_cast<Index>(s / col_weight);
+    ::std::shuffle(sockets.begin(), sockets.end(), rand_example);
+    for (auto i{0ULL}; i < csr.rows; i++)
+    {
+        ::std::vector<Index> row(sockets.begin() + i * row_weight, sockets.begin() + (i + 1) * row_weight);
+        ::std::sort(row.begin(), row.end());
+        for (auto k{0ULL}; k < row.size(); k++)
+        {
+            if (k + 1 < row.size() && row[k] == row[k + 1])
+                k++;
+            else
+                csr.edge_cols.push_back(row[k]);
+        }
+        csr.row_offsets.push_back(static_cast<Index>(csr.edge_cols.size()));
+    }
+    return csr;
+}
+
+// Repeat f until at least `budget` ns have passed, returning the mean ns per call.
+template <typename F>
+static double meanNs(F &&f, double budget = 2e8)
+{
+    f(); // warm up
+    size_t calls{0};
+    auto const start{Clock::now()};
+    auto elapsed{0.};
+    while (elapsed < budget)
+    {
+        f();
+        calls++;
+        elapsed = nanoseconds(start, Clock::now());
+    }
+    return elapsed / calls;
+}
+
+static ::nlohmann::json benchGraph(Csr const &csr, ::sparse_matrix::Mod2SparseMatrix const &matrix)
+{
+    auto const edges{static_cast<double>(matrix.edges())};
+    auto const construct{meanNs([&]()
+                                { ::sparse_matrix::Mod2SparseMatrix built(csr.rows, csr.cols, csr.row_offsets, csr.edge_cols); })};
+    ::std::ostringstream alist;
+    alist << matrix;
+    auto const text{alist.str()};
+    auto const parse{meanNs([&]()
+                            { auto parsed{::sparse_matrix::Mod2SparseMatrix::parseAlist(text)}; })};
+    return {
+        {"construct_ns"sv, construct},
+        {"construct_edges_per_s"sv, edges / construct * 1e9},
+        {"alist_bytes"sv, text.size()},
+        {"alist_parse_ns"sv, parse},
+        {"alist_parse_edges_per_s"sv, edges / parse * 1e9}};
+}
+
+// Sample `shots` errors with nonzero syndrome; returns the syndromes (one byte per check) back to back.
+static ::std::vector<uint8_t> sampleSyndromes(::sparse_matrix::Mod2SparseMatrix const &matrix, double p, size_t shots, ::std::mt19937_64 &rand_example)
+{
+    ::std::bernoulli_distribution flip{p};
+    ::std::vector<uint8_t> error(matrix.cols()), syndrome(matrix.rows()), syndromes;
+    syndromes.reserve(shots * matrix.rows());
+    while (syndromes.size() < shots * matrix.rows())
+    {
+        for (auto &bit : error)
+            bit = flip(rand_example);
+        matrix.multiply(error, syndrome);
+        if (::std::find(syndrome.begin(), syndrome.end(), 1) != syndrome.end())
+            syndromes.insert(syndromes.end(), syndrome.begin(), syndrome.end());
+    }
+    return syndromes;
+}
+
+static ::nlohmann::json benchMatVec(::sparse_matrix::Mod2SparseMatrix const &matrix, double p, ::std::mt19937_64 &rand_example)
+{
+    ::std::bernoulli_distribution flip{p};
+    ::std::vector<uint8_t> bytes(matrix.cols());
+    for (auto &bit : bytes)
+        bit = flip(rand_example);
+    auto const error{::sparse_matrix::Mod2Vector::fromBytes(bytes)};
+    ::sparse_matrix::Mod2Vector syndrome(matrix.rows());
+    ::std::vector<uint8_t> byte_syndrome(matrix.rows());
+    auto const packed{meanNs([&]()
+                             { matrix.multiply(error, syndrome); })};
+    auto const unpacked{meanNs([&]()
+                               { matrix.multiply(bytes, byte_syndrome); })};
+    return {
+        {"packed_ns"sv, packed},
+        {"packed_edges_per_s"sv, matrix.edges() / packed * 1e9},
+        {"bytes_ns"sv, unpacked},
+        {"bytes_edges_per_s"sv, matrix.edges() / unpacked * 1e9}};
+}
+
+static ::nlohmann::json benchDecode(::sparse_matrix::Mod2SparseMatrix const &matrix, double p, ::std::vector<uint8_t> const &syndromes, size_t shots)
+{
+    auto const rows{matrix.rows()};
+    ::bp_decoder::BpDecoder decoder{matrix, ::bp_decoder::BpDecoder::Method::MIN_SUM, p, max_iter};
+    ::std::vector<double> latencies(shots);
+    size_t iterations{0}, converged{0};
+    for (auto s{0ULL}; s < shots; s++)
+    {
+        ::std::span<uint8_t const> syndrome{&syndromes[s * rows], rows};
+        auto const start{Clock::now()};
+        auto const result{decoder.decode(syndrome)};
+        latencies[s] = nanoseconds(start, Clock::now());
+        // Result::iter is the index of the converging iteration.
+        iterations += result.converge ? result.iter + 1 : result.iter;
+        converged += result.converge;
+    }
+    auto const total{::std::accumulate(latencies.begin(), latencies.end(), 0.)};
+    ::std::sort(latencies.begin(), latencies.end());
+    return {
+        {"shots"sv, shots},
+        {"converged"sv, converged},
+        {"mean_iterations"sv, static_cast<double>(iterations) / shots},
+        {"latency_mean_ns"sv, total / shots},
+        {"latency_p50_ns"sv, latencies[shots / 2]},
+        {"latency_p99_ns"sv, latencies[shots * 99 / 100]},
+        {"shots_per_s"sv, shots / total * 1e9},
+        {"ns_per_edge_iteration"sv, total / (static_cast<double>(matrix.edges()) * iterations)}};
+}
+
+static ::nlohmann::json benchBatch(::sparse_matrix::Mod2SparseMatrix const &matrix, double p, ::std::vector<uint8_t> const &syndromes, size_t shots)
+{
+    auto const rows{matrix.rows()};
+    ::bp_decoder::BatchBpDecoder<batch_lanes> decoder{matrix, p, max_iter};
+    // A batch runs until its slowest lane stops; every lane pays for those iterations.
+    size_t lane_iterations{0}, converged{0};
+    auto const start{Clock::now()};
+    for (size_t s{0}; s < shots; s += batch_lanes)
+    {
+        auto const count{::std::min(batch_lanes, shots - s)};
+        auto const result{decoder.decode(::std::span{syndromes}.subspan(s * rows, count * rows), count)};
+        uint32_t slowest{0};
+        for (auto l{0ULL}; l < count; l++)
+        {
+            slowest = ::std::max(slowest, result.converge[l] ? result.iter[l] + 1 : result.iter[l]);
+            converged += result.converge[l];
+        }
+        lane_iterations += slowest * batch_lanes;
+    }
+    auto const total{nanoseconds(start, Clock::now())};
+    return {
+        {"lanes"sv, batch_lanes},
+        {"shots"sv, shots},
+        {"converged"sv, converged},
+        {"shots_per_s"sv, shots / total * 1e9},
+        {"ns_per_edge_iteration"sv, total / (static_cast<double>(matrix.edges()) * lane_iterations)}};
+}
+
+int main(int argc, char *argv[])
+{
+    // Shots must be a positive decimal integer: the statistics below divide by it and index the sorted latencies.
+    size_t shots{1000};
+    if (argc > 1)
+    {
+        ::std::string_view const arg{argv[1]};
+        auto const [end, error]{::std::from_chars(arg.data(), arg.data() + arg.size(), shots)};
+        if (error != ::std::errc{} || end != arg.data() + arg.size() || shots < 1)
+        {
+            ::std::cerr << "Usage: bp_bench [shots >= 1] [output.json]\n"sv;
+            return 1;
+        }
+    }
+    // Open the output before the run, so that a bad path fails at once.
+    ::std::ofstream file;
+    if (argc > 2)
+    {
+        file.open(argv[2]);
+        if (!file)
+        {
+            ::std::cerr << "Could not create file: "sv << argv[2] << '\n';
+            return 1;
+        }
+    }
+    auto const sizes = {1024ULL, 4096ULL, 16384ULL};
+    auto const error_rates = {0.02, 0.04, 0.06};
+
+    ::std::mt19937_64 rand_example{149};
+    auto codes = ::nlohmann::json::array();
+    for (auto cols : sizes)
+    {
+        auto const csr{randomRegularCode(cols, rand_example)};
+        ::sparse_matrix::Mod2SparseMatrix matrix(csr.rows, csr.cols, csr.row_offsets, csr.edge_cols);
+        auto points = ::nlohmann::json::array();
+        for (auto p : error_rates)
+        {
+            auto const syndromes{sampleSyndromes(matrix, p, shots, rand_example)};
+            points.push_back({{"bit_error_rate"sv, p},
+                              {"matvec"sv, benchMatVec(matrix, p, rand_example)},
+                              {"decode"sv, benchDecode(matrix, p, syndromes, shots)},
+                              {"batch"sv, benchBatch(matrix, p, syndromes, shots)}});
+        }
+        codes.push_back({{"rows"sv, matrix.rows()},
+                         {"cols"sv, matrix.cols()},
+                         {"edges"sv, matrix.edges()},
+                         {"graph"sv, benchGraph(csr, matrix)},
+                         {"points"sv, points}});
+    }
+    ::nlohmann::json report{{"code_family"sv, "random (3, 6)-regular"sv}, {"max_iter"sv, max_iter}, {"codes"sv, codes}};
+
+    if (argc > 2)
+    {
+        file << report.dump(4) << '\n';
+        if (!file.flush())
+        {
+            ::std::cerr << "Could not write file: "sv << argv[2] << '\n';
+            return 1;
+        }
+    }
+    else
+        ::std::cout << report.dump(4) << '\n';
+    return 0;
+}
@@ -0,0 +1,121 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+// Microbenchmark of the min-sum check-node pass: the previous pow()/equality-test kernel against
+// bp_decoder::minSumCheckNode, on the rows of an alist matrix with random messages.
+#include <string>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "bp_decoder/check_node.hpp"
+#include "sparse_matrix/sparse_matrix.hpp"
+
+using ::std::operator""sv;
+
+// The check-node half of BpDecoder::update before the rewrite, kept verbatim for comparison.
+static void legacyCheckNodes(::sparse_matrix::Mod2SparseMatrix const &matrix, ::std::vector<double> const &prob_rates, ::std::vector<double> &like_rates, ::std::vector<uint8_t> const &syndrome, double alpha)
+{
+    auto const row_offsets{matrix.rowOffsets()};
+    int mod2row_weight;
+    double min[2];
+    double sgn{0.};
+    for (auto i{0ULL}; i < matrix.rows(); i++)
+    {
+        mod2row_weight = syndrome[i];
+        min[0] = min[1] = ::std::numeric_limits<double>::infinity();
+        auto const begin{row_offsets[i]}, end{row_offsets[i + 1]};
+        for (auto e{begin}; e < end; e++)
+        {
+            auto pr = prob_rates[e];
+            auto abs_pr = ::std::fabs(pr);
+            if (abs_pr < min[0])
+                min[1] = min[0], min[0] = abs_pr;
+            else if (abs_pr < min[1])
+                min[1] = abs_pr;
+            if (pr <= 0)
+                mod2row_weight++;
+        }
+        for (auto e{end}; e-- > begin;)
+        {
+            auto pr = prob_rates[e];
+            auto abs_pr = ::std::fabs(pr);
+            if (pr <= 0)
+                sgn += mod2row_weight;
+            else
+                sgn = mod2row_weight;
+            sgn = ::std::pow(-1, sgn);
+            like_rates[e] = alpha * sgn * ((abs_pr == min[0]) ? min[1] : min[0]);
+        }
+    }
+}
+
+static void checkNodes(::sparse_matrix::Mod2SparseMatrix const &matrix, ::std::vector<double> const &prob_rates, ::std::vector<double> &like_rates, ::std::vector<uint8_t> const &syndrome, double alpha)
+{
+    auto const row_offsets{matrix.rowOffsets()};
+    for (auto i{0ULL}; i < matrix.rows(); i++)
+    {
+        auto const begin{row_offsets[i]}, end{row_offsets[i + 1]};
+        ::bp_decoder::minSumCheckNode(&prob_rates[begin], &like_rates[begin], end - begin, syndrome[i], alpha);
+    }
+}
+
+template <typename F>
+static double nsPerEdge(F &&f, size_t edges, int repeats)
+{
+    f(); // warm up
+    auto start{::std::chrono::steady_clock::now()};
+    for (auto r{0}; r < repeats; r++)
+        f();
+    auto end{::std::chrono::steady_clock::now()};
+    return ::std::chrono::duration<double, ::std::nano>(end - start).count() / (static_cast<double>(edges) * repeats);
+}
+
+int main(int argc, char *argv[])
+{
+    auto const alist{argc > 1 ? argv[1] : "../data/test.alist"};
+    auto const repeats{argc > 2 ? ::std::stoi(argv[2]) : 2000};
+
+    ::sparse_matrix::Mod2SparseMatrix matrix;
+    ::std::ifstream{alist} >> matrix;
+
+    ::std::mt19937 rand_example{149};
+    ::std::normal_distribution<double> llr{2., 3.};
+    ::std::vector<double> prob_rates(matrix.edges()), legacy_rates(matrix.edges()), like_rates(matrix.edges());
+    ::std::vector<uint8_t> syndrome(matrix.rows());
+    for (auto &pr : prob_rates)
+        pr = llr(rand_example);
+    for (auto &bit : syndrome)
+        bit = rand_example() & 1;
+    auto const alpha{0.75};
+
+    auto const legacy{nsPerEdge([&]()
+                                { legacyCheckNodes(matrix, prob_rates, legacy_rates, syndrome, alpha); },
+                                matrix.edges(), repeats)};
+    auto const current{nsPerEdge([&]()
+                                 { checkNodes(matrix, prob_rates, like_rates, syndrome, alpha); },
+                                 matrix.edges(), repeats)};
+
+    // The legacy kernel carries its sign accumulator across rows, so a few edges may legitimately differ.
+    auto mismatches{0ULL};
+    for (auto e{0ULL}; e < matrix.edges(); e++)
+        mismatches += legacy_rates[e] != like_rates[e];
+
+    ::std::cout << "matrix: "sv << matrix.rows() << 'x' << matrix.cols() << ", "sv << matrix.edges() << " edges\n"sv
+                << "legacy:  "sv << legacy << " ns/edge\n"sv
+                << "current: "sv << current << " ns/edge\n"sv
+                << "speedup: "sv << legacy / current << "x\n"sv
+                << "mismatched edges: "sv << mismatches << '\n';
+    return 0;
+}
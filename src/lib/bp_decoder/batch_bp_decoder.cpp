@@ -0,0 +1,215 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#include "batch_bp_decoder.hpp"
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace bp_decoder
+{
+    namespace
+    {
+        // Rows between checks for an early exit of satisfiedLanes(), amortizing the reduction over the lanes.
+        constexpr size_t satisfied_stride{32};
+    }
+
+    template <size_t Lanes>
+    void BatchBpDecoder<Lanes>::init(::std::span<uint8_t const> syndromes, size_t count)
+    {
+        auto const rows{this->matrix.rows()};
+        auto const edge_cols{this->matrix.edgeCols()};
+        for (auto e{0ULL}; e < this->matrix.edges(); e++)
+            ::std::fill_n(&this->prob_rates[e * Lanes], Lanes, this->channel_llrs[edge_cols[e]]);
+        ::std::fill(this->hard_decisions.begin(), this->hard_decisions.end(), 0);
+        ::std::fill(this->syndrome_bits.begin(), this->syndrome_bits.end(), 0);
+        ::std::fill(this->iters.begin(), this->iters.end(), 0);
+        ::std::fill(this->converged.begin(), this->converged.end(), 0);
+        for (auto l{0ULL}; l < count; l++)
+            for (auto i{0ULL}; i < rows; i++)
+                this->syndrome_bits[i * Lanes + l] = syndromes[l * rows + i] & 1;
+    }
+    template <size_t Lanes>
+    void BatchBpDecoder<Lanes>::update(int iter)
+    {
+        auto const row_offsets{this->matrix.rowOffsets()};
+        auto const col_offsets{this->matrix.colOffsets()};
+        auto const col_edges{this->matrix.colEdges()};
+        auto *const prob_rates{this->prob_rates.data()};
+        auto *const like_rates{this->like_rates.data()};
+        auto const alpha{static_cast<float>(1.0 - ::std::pow(0.5, iter + 1))};
+
+        // Check nodes: track the two smallest magnitudes, the argmin edge and the sign parity per lane.
+        ::std::array<float, Lanes> min1, min2;
+        ::std::array<uint32_t, Lanes> argmin, parity;
+        for (auto i{0ULL}; i < this->matrix.rows(); i++)
+        {
+            auto const begin{row_offsets[i]}, end{row_offsets[i + 1]};
+            auto const *synd{&this->syndrome_bits[i * Lanes]};
+            for (auto l{0ULL}; l < Lanes; l++)
+            {
+                min1[l] = min2[l] = ::std::numeric_limits<float>::infinity();
+                argmin[l] = begin;
+                parity[l] = synd[l];
+            }
+            for (auto e{begin}; e < end; e++)
+            {
+                auto const *pr{prob_rates + e * Lanes};
+                for (auto l{0ULL}; l < Lanes; l++)
+                {
+                    auto const abs_pr{::std::fabs(pr[l])};
+                    auto const less{abs_pr < min1[l]};
+                    min2[l] = less ? min1[l] : ::std::min(min2[l], abs_pr);
+                    min1[l] = less ? abs_pr : min1[l];
+                    argmin[l] = less ? e : argmin[l];
+                    parity[l] ^= static_cast<uint32_t>(pr[l] <= 0);
+                }
+            }
+            for (auto e{begin}; e < end; e++)
+            {
+                auto const *pr{prob_rates + e * Lanes};
+                auto *lr{like_rates + e * Lanes};
+                for (auto l{0ULL}; l < Lanes; l++)
+                {
+                    auto const magnitude{alpha * (argmin[l] == e ? min2[l] : min1[l])};
+                    auto const negative{parity[l] ^ static_cast<uint32_t>(pr[l] <= 0)};
+                    lr[l] = negative ? -magnitude : magnitude;
+                }
+            }
+        }
+
+        // Bit nodes: posterior, extrinsic messages and hard decisions for lanes still running.
+        ::std::array<float, Lanes> posterior;
+        for (auto j{0ULL}; j < this->matrix.cols(); j++)
+        {
+            auto const begin{col_offsets[j]}, end{col_offsets[j + 1]};
+            posterior.fill(this->channel_llrs[j]);
+            for (auto k{begin}; k < end; k++)
+            {
+                auto const *lr{like_rates + col_edges[k] * Lanes};
+                for (auto l{0ULL}; l < Lanes; l++)
+                    posterior[l] += lr[l];
+            }
+            for (auto k{begin}; k < end; k++)
+            {
+                auto const *lr{like_rates + col_edges[k] * Lanes};
+                auto *pr{prob_rates + col_edges[k] * Lanes};
+                for (auto l{0ULL}; l < Lanes; l++)
+                    pr[l] = posterior[l] - lr[l];
+            }
+            auto *hard{&this->hard_decisions[j * Lanes]};
+            for (auto l{0ULL}; l < Lanes; l++)
+                hard[l] = this->converged[l] ? hard[l] : static_cast<uint32_t>(posterior[l] <= 0);
+        }
+    }
+    template <size_t Lanes>
+    uint64_t BatchBpDecoder<Lanes>::satisfiedLanes(uint64_t pending) const
+    {
+        auto const row_offsets{this->matrix.rowOffsets()};
+        auto const edge_cols{this->matrix.edgeCols()};
+        ::std::array<uint32_t, Lanes> unsatisfied{}, parity;
+        // Lanes outside `pending` are already frozen: count them as unsatisfied so they never hold up the exit.
+        for (auto l{0ULL}; l < Lanes; l++)
+            unsatisfied[l] = !(pending >> l & 1);
+        auto const rows{this->matrix.rows()};
+        for (auto i{0ULL}; i < rows; i++)
+        {
+            auto const *synd{&this->syndrome_bits[i * Lanes]};
+            for (auto l{0ULL}; l < Lanes; l++)
+                parity[l] = synd[l];
+            for (auto e{row_offsets[i]}; e < row_offsets[i + 1]; e++)
+            {
+                auto const *hard{&this->hard_decisions[edge_cols[e] * Lanes]};
+                for (auto l{0ULL}; l < Lanes; l++)
+                    parity[l] ^= hard[l];
+            }
+            for (auto l{0ULL}; l < Lanes; l++)
+                unsatisfied[l] |= parity[l];
+            // A lane that is not converged usually breaks a check early in the scan; stop once every lane has.
+            if (i % satisfied_stride == satisfied_stride - 1 &&
+                ::std::all_of(unsatisfied.begin(), unsatisfied.end(), [](uint32_t u)
+                              { return u != 0; }))
+                return 0;
+        }
+        uint64_t mask{0};
+        for (auto l{0ULL}; l < Lanes; l++)
+            mask |= static_cast<uint64_t>(!unsatisfied[l]) << l;
+        return mask;
+    }
+    template <size_t Lanes>
+    void BatchBpDecoder<Lanes>::freeze(size_t lane, uint32_t iter)
+    {
+        auto const cols{this->matrix.cols()};
+        this->iters[lane] = iter;
+        for (auto j{0ULL}; j < cols; j++)
+            this->decodings[lane * cols + j] = static_cast<uint8_t>(this->hard_decisions[j * Lanes + lane]);
+    }
+    template <size_t Lanes>
+    BatchBpDecoder<Lanes>::BatchBpDecoder(::sparse_matrix::Mod2SparseMatrix const &matrix, double error_prob, int max_iter)
+        : matrix{matrix}, max_iter{max_iter},
+          channel_llrs(matrix.cols(), static_cast<float>(::std::log((1 - error_prob) / error_prob))),
+          prob_rates(matrix.edges() * Lanes), like_rates(matrix.edges() * Lanes),
+          syndrome_bits(matrix.rows() * Lanes), hard_decisions(matrix.cols() * Lanes),
+          iters(Lanes), converged(Lanes), decodings(matrix.cols() * Lanes)
+    {
+        if (!(error_prob > 0 && error_prob <= 0.5))
+            throw ::std::invalid_argument("Error probability must be in (0, 0.5]."s);
+    }
+    template <size_t Lanes>
+    void BatchBpDecoder<Lanes>::setErrorProb(double error_prob)
+    {
+        if (!(error_prob > 0 && error_prob <= 0.5))
+            throw ::std::invalid_argument("Error probability must be in (0, 0.5]."s);
+        ::std::fill(this->channel_llrs.begin(), this->channel_llrs.end(), static_cast<float>(::std::log((1 - error_prob) / error_prob)));
+    }
+    template <size_t Lanes>
+    void BatchBpDecoder<Lanes>::setPriorLlrs(::std::span<double const> log_prob_ratios)
+    {
+        if (log_prob_ratios.size() != this->matrix.cols())
+            throw ::std::invalid_argument("Priors length mismatch matrix col."s);
+        if (!::std::all_of(log_prob_ratios.begin(), log_prob_ratios.end(), [](double llr)
+                           { return ::std::isfinite(llr) && llr >= 0; }))
+            throw ::std::invalid_argument("Prior LLRs must be finite and non-negative."s);
+        ::std::transform(log_prob_ratios.begin(), log_prob_ratios.end(), this->channel_llrs.begin(), [](double llr)
+                         { return static_cast<float>(llr); });
+    }
+    template <size_t Lanes>
+    typename BatchBpDecoder<Lanes>::Result BatchBpDecoder<Lanes>::decode(::std::span<uint8_t const> syndromes, size_t count)
+    {
+        if (count > Lanes || syndromes.size() < count * this->matrix.rows())
+            throw ::std::runtime_error("Batch syndromes length mismatch matrix row."s);
+        this->init(syndromes, count);
+        auto pending{Lanes == 64 ? ~0ULL : (1ULL << Lanes) - 1};
+        for (auto it{0}; it < this->max_iter && pending; it++)
+        {
+            this->update(it);
+            auto const newly{this->satisfiedLanes(pending)};
+            for (auto l{0ULL}; l < Lanes; l++)
+            {
+                if (newly >> l & 1)
+                {
+                    this->converged[l] = 1;
+                    this->freeze(l, static_cast<uint32_t>(it));
+                }
+            }
+            pending &= ~newly;
+        }
+        for (auto l{0ULL}; l < Lanes; l++)
+            if (pending >> l & 1)
+                this->freeze(l, static_cast<uint32_t>(this->max_iter));
+        return {this->iters, this->converged, this->decodings};
+    }
+
+    template class BatchBpDecoder<8>;
+    template class BatchBpDecoder<16>;
+    template class BatchBpDecoder<32>;
+}
@@ -0,0 +1,82 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#pragma once
+
+#ifndef _BATCH_BP_DECODER_HPP_
+#define _BATCH_BP_DECODER_HPP_
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include "sparse_matrix.hpp"
+
+namespace bp_decoder
+{
+    // Min-sum decoder running `Lanes` syndromes in lockstep over one Tanner graph.
+    // Messages are stored shot-minor (edge e, lane l at e * Lanes + l), so every inner loop is a fixed-width
+    // lane loop the compiler turns into SIMD. Lanes that converge are frozen while the others keep iterating:
+    // their decisions and results no longer change, but their messages still ride along in the lane loops, where
+    // masking them out would save no work.
+    // Messages are single-precision to double the lanes per vector, so a lane can decide differently from the
+    // double-precision BpDecoder with MIN_SUM and FLOODING when a posterior rounds across zero.
+    // Instantiated for 8, 16 and 32 lanes.
+    template <size_t Lanes>
+    class BatchBpDecoder
+    {
+    public: // types
+        static constexpr size_t lanes{Lanes};
+        // Views into the decoder workspace, valid until the next decode() call.
+        struct Result
+        {
+            ::std::span<uint32_t const> iter;      // per lane
+            ::std::span<uint8_t const> converge;   // per lane
+            ::std::span<uint8_t const> decodings;  // lane-major, lanes * matrix.cols()
+        };
+
+    private: // vars
+        ::sparse_matrix::Mod2SparseMatrix matrix;
+        int max_iter;
+        ::std::vector<float> channel_llrs; // per column, uniform unless setPriorLlrs() was called
+
+    private: // workspace
+        ::std::vector<float> prob_rates, like_rates; // shot-minor, edges * Lanes
+        ::std::vector<uint32_t> syndrome_bits;       // shot-minor, rows * Lanes
+        ::std::vector<uint32_t> hard_decisions;      // shot-minor, cols * Lanes
+        ::std::vector<uint32_t> iters;
+        ::std::vector<uint8_t> converged;
+        ::std::vector<uint8_t> decodings;
+
+    private: // utils
+        void init(::std::span<uint8_t const> syndromes, size_t count);
+        void update(int iter);
+        // Returns the mask of `pending` lanes whose hard decision satisfies its syndrome. Frozen lanes are not
+        // checked, and the scan stops as soon as every pending lane has an unsatisfied check.
+        uint64_t satisfiedLanes(uint64_t pending) const;
+        void freeze(size_t lane, uint32_t iter);
+
+    public: // apis
+        BatchBpDecoder(::sparse_matrix::Mod2SparseMatrix const &matrix, double error_prob, int max_iter);
+        // Switch to a uniform error_prob in (0, 0.5], e.g. between points of a sweep, keeping the workspace.
+        void setErrorProb(double error_prob);
+        // Per-column channel LLRs log((1 - p_j) / p_j) >= 0 in place of the uniform error_prob, as in BpDecoder.
+        void setPriorLlrs(::std::span<double const> log_prob_ratios);
+        // Decode `count` <= Lanes syndromes stored lane-major (syndromes[l * rows + i], one byte per check).
+        // Unused lanes are decoded as the zero syndrome.
+        Result decode(::std::span<uint8_t const> syndromes, size_t count = Lanes);
+    };
+
+    extern template class BatchBpDecoder<8>;
+    extern template class BatchBpDecoder<16>;
+    extern template class BatchBpDecoder<32>;
+}
+
+#endif
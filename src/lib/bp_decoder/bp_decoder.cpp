@@ -9,173 +9,447 @@
  * See the Mulan PubL v2 for more details.
  */
 #include "bp_decoder.hpp"
+#include "check_node.hpp"
 
 #include <iostream>
 #include <cmath>
 #include <numeric>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
 
 namespace bp_decoder
 {
-    auto BpDecoder::getParityChecks(::sparse_matrix::Mod2SparseMatrix const &matrix, ::std::vector<uint8_t> const &code_word)
+    void BpDecoder::init(::std::span<uint8_t const> syndrome)
     {
-        return matrix * code_word;
+        // Every bit -> check message starts from the prior of its bit.
+        auto const edge_cols{this->matrix.edgeCols()};
+        if (this->method == Method::QUANTIZED_MIN_SUM)
+        {
+            for (auto e{0ULL}; e < this->quant8_prob_rates.size(); e++)
+                this->quant8_prob_rates[e] = static_cast<int8_t>(this->quant_channel[edge_cols[e]]);
+            for (auto e{0ULL}; e < this->quant16_prob_rates.size(); e++)
+                this->quant16_prob_rates[e] = static_cast<int16_t>(this->quant_channel[edge_cols[e]]);
+            ::std::fill(this->quant8_like_rates.begin(), this->quant8_like_rates.end(), 0);
+            ::std::fill(this->quant16_like_rates.begin(), this->quant16_like_rates.end(), 0);
+            if (!this->quant_posteriors.empty())
+                ::std::copy(this->quant_channel.begin(), this->quant_channel.end(), this->quant_posteriors.begin());
+        }
+        else
+        {
+            for (auto e{0ULL}; e < this->prob_rates.size(); e++)
+                this->prob_rates[e] = this->channel_llrs[edge_cols[e]];
+            ::std::fill(this->like_rates.begin(), this->like_rates.end(), 0.);
+        }
+        // The layered schedule keeps its running posteriors here, starting from the prior.
+        if (this->schedule == Schedule::LAYERED)
+            ::std::copy(this->channel_llrs.begin(), this->channel_llrs.end(), this->log_prob_ratios.begin());
+        else
+            ::std::fill(this->log_prob_ratios.begin(), this->log_prob_ratios.end(), 0.);
+        // With an all-zero decoding every check of the syndrome is unsatisfied.
+        ::std::fill(this->decoding.begin(), this->decoding.end(), 0);
+        ::std::copy(syndrome.begin(), syndrome.end(), this->residual_syndrome.begin());
+        this->unsatisfied = ::std::count(syndrome.begin(), syndrome.end(), 1);
     }
-    auto BpDecoder::init(::sparse_matrix::Mod2SparseMatrix &hx, ::std::vector<uint8_t> const &bit_error)
+    BpDecoder::Result BpDecoder::shortCircuit(Correction const &correction)
     {
-        double prob_ratio_initial;
-        if (method == Method::MIN_SUM)
-            prob_ratio_initial = log((1 - this->error_prob) / this->error_prob);
-        else
-            prob_ratio_initial = this->error_prob / (1 - this->error_prob);
-        for (auto const &row : hx.items_each_row)
+        ::std::fill(this->decoding.begin(), this->decoding.end(), 0);
+        ::std::copy(this->channel_llrs.begin(), this->channel_llrs.end(), this->log_prob_ratios.begin());
+        for (auto k{0}; k < correction.count; k++)
         {
-            for (auto const &item : row)
-            {
-                item->value.prob_rate = prob_ratio_initial;
-                item->value.like_rate = 1;
-            }
+            this->decoding[correction.cols[k]] = 1;
+            this->log_prob_ratios[correction.cols[k]] = -this->channel_llrs[correction.cols[k]];
         }
-        ::std::vector<double> log_prob_ratios(hx.col, 0.);
-        ::std::vector<uint8_t> bit_syndrome{this->getParityChecks(hx, bit_error)};
-        ::std::vector<uint8_t> decoding(hx.col, 0);
-        return ::std::make_tuple(prob_ratio_initial, log_prob_ratios, bit_syndrome, decoding);
+        auto const looked_up{correction.count != 0};
+        return {0, !looked_up, this->log_prob_ratios, this->decoding, false, looked_up};
     }
-    void BpDecoder::update(::sparse_matrix::Mod2SparseMatrix &matrix, ::std::vector<uint8_t> &decoding, ::std::vector<double> &log_prob_ratios, ::std::vector<uint8_t> const &syndrome, double prob_ratio_initial, int iter)
+    double BpDecoder::cost(Correction const &correction) const
     {
-        if (method == Method::MIN_SUM)
+        auto total{0.};
+        for (auto k{0}; k < correction.count; k++)
+            total += this->channel_llrs[correction.cols[k]];
+        return total;
+    }
+    void BpDecoder::buildLookup()
+    {
+        auto const rows{this->matrix.rows()};
+        auto const row_offsets{this->matrix.rowOffsets()};
+        auto const edge_cols{this->matrix.edgeCols()};
+        auto const col_offsets{this->matrix.colOffsets()};
+        auto const col_rows{this->matrix.colRows()};
+        auto const consider = [&](Index r1, Index r2, Correction const &correction)
         {
-            // Recompute likelihood ratios.
-            double alpha{1.0 - ::std::pow(0.5, iter + 1)};
-            int mod2row_weight;
-            double min[2];
-            double sgn{0.};
-            for (auto i{0ULL}; i < matrix.row; i++)
+            // r2 == r1 marks a weight-1 syndrome.
+            auto &slot{r1 == r2 ? this->lookup_single[r1] : this->lookup_pair[static_cast<uint64_t>(r1) * rows + r2]};
+            if (slot.count == 0 || this->cost(correction) < this->cost(slot))
+                slot = correction;
+        };
+        this->lookup_single.assign(rows, Correction{{0, 0}, 0});
+        this->lookup_pair.clear();
+        this->lookup_column.assign(rows, no_column);
+        for (Index j{0}; j < this->matrix.cols(); j++)
+        {
+            auto const begin{col_offsets[j]}, weight{col_offsets[j + 1] - begin};
+            if (weight == 1 || weight == 2)
+                consider(col_rows[begin], col_rows[begin + weight - 1], {{j, j}, 1});
+            if (weight == 1)
             {
-                mod2row_weight = syndrome[i];
-                min[0] = min[1] = ::std::numeric_limits<double>::infinity();
-                auto const &row = matrix.items_each_row[i];
-                for (auto it{row.begin()}; it != row.end(); it++)
-                {
-                    auto pr = (*it)->value.prob_rate;
-                    auto abs_pr = ::std::fabs(pr);
-                    if (abs_pr < min[0])
-                        min[1] = min[0], min[0] = abs_pr;
-                    else if (abs_pr < min[1])
-                        min[1] = abs_pr;
-                    if (pr <= 0)
-                        mod2row_weight++;
-                }
-                for (auto it{row.rbegin()}; it != row.rend(); it++)
+                auto &slot{this->lookup_column[col_rows[begin]]};
+                if (slot == no_column || this->channel_llrs[j] < this->channel_llrs[slot])
+                    slot = j;
+            }
+        }
+        // Two bits with disjoint checks reach a syndrome of weight <= 2 only as two weight-1 bits, which decode()
+        // combines from lookup_column. Every other such pair shares a check, so it is found within a row.
+        Index diff[3];
+        for (auto i{0ULL}; i < rows; i++)
+        {
+            for (auto e{row_offsets[i]}; e < row_offsets[i + 1]; e++)
+            {
+                for (auto f{e + 1}; f < row_offsets[i + 1]; f++)
                 {
-                    auto pr = (*it)->value.prob_rate;
-                    auto abs_pr = ::std::fabs(pr);
-                    auto &lr = (*it)->value.like_rate;
-                    if (pr <= 0)
-                        sgn += mod2row_weight;
-                    else
-                        sgn = mod2row_weight;
-                    sgn = ::std::pow(-1, sgn);
-                    lr = alpha * sgn * ((abs_pr == min[0]) ? min[1] : min[0]);
+                    auto const a{edge_cols[e]}, b{edge_cols[f]};
+                    // Symmetric difference of the sorted column lists, abandoned past two rows.
+                    size_t size{0};
+                    auto p{col_offsets[a]}, q{col_offsets[b]};
+                    while ((p < col_offsets[a + 1] || q < col_offsets[b + 1]) && size < 3)
+                    {
+                        if (q == col_offsets[b + 1] || (p < col_offsets[a + 1] && col_rows[p] < col_rows[q]))
+                            diff[size++] = col_rows[p++];
+                        else if (p == col_offsets[a + 1] || col_rows[q] < col_rows[p])
+                            diff[size++] = col_rows[q++];
+                        else
+                        {
+                            p++;
+                            q++;
+                        }
+                    }
+                    if (size == 1 || size == 2)
+                        consider(diff[0], diff[size - 1], {{a, b}, 2});
                 }
             }
-            // Recompute log-probability-ratios for the bits
-            double pr;
-            for (auto j{0ULL}; j < matrix.col; j++)
+        }
+    }
+    inline void BpDecoder::decide(size_t col, uint8_t bit)
+    {
+        if (this->decoding[col] == bit)
+            return;
+        this->decoding[col] = bit;
+        auto const col_offsets{this->matrix.colOffsets()};
+        auto const col_rows{this->matrix.colRows()};
+        for (auto k{col_offsets[col]}; k < col_offsets[col + 1]; k++)
+        {
+            auto &residual{this->residual_syndrome[col_rows[k]]};
+            residual ^= 1;
+            this->unsatisfied += residual ? 1 : -1;
+        }
+    }
+    template <typename Q>
+    void BpDecoder::updateQuantized(::std::vector<Q> &prob_rates, ::std::vector<Q> &like_rates, ::std::span<uint8_t const> syndrome, int iter)
+    {
+        auto const row_offsets{this->matrix.rowOffsets()};
+        auto const col_offsets{this->matrix.colOffsets()};
+        auto const col_edges{this->matrix.colEdges()};
+        int32_t const qmax{(1 << (this->quant_bits - 1)) - 1};
+        auto const shift{::std::min(iter + 1, 31)};
+
+        if (this->schedule == Schedule::LAYERED)
+        {
+            auto const edge_cols{this->matrix.edgeCols()};
+            auto &posteriors{this->quant_posteriors};
+            for (auto i{0ULL}; i < this->matrix.rows(); i++)
+            {
+                auto const begin{row_offsets[i]}, end{row_offsets[i + 1]};
+                for (auto e{begin}; e < end; e++)
+                    prob_rates[e] = static_cast<Q>(::std::clamp(posteriors[edge_cols[e]] - like_rates[e], -qmax, qmax));
+                quantizedMinSumCheckNode(&prob_rates[begin], &like_rates[begin], end - begin, syndrome[i], qmax, shift);
+                for (auto e{begin}; e < end; e++)
+                    posteriors[edge_cols[e]] = prob_rates[e] + like_rates[e];
+            }
+            for (auto j{0ULL}; j < this->matrix.cols(); j++)
             {
-                pr = prob_ratio_initial;
-                auto const &col = matrix.items_each_col[j];
-                for (auto it{col.begin()}; it != col.end(); it++)
-                    pr += (*it)->value.like_rate;
-                log_prob_ratios[j] = pr;
-                decoding[j] = pr <= 0;
-                for (auto it{col.rbegin()}; it != col.rend(); it++)
-                    (*it)->value.prob_rate = pr - (*it)->value.like_rate;
+                this->log_prob_ratios[j] = posteriors[j] / this->llr_scale;
+                this->decide(j, posteriors[j] <= 0);
             }
+            return;
         }
-        else
+
+        // Recompute likelihood ratios.
+        for (auto i{0ULL}; i < this->matrix.rows(); i++)
+        {
+            auto const begin{row_offsets[i]}, end{row_offsets[i + 1]};
+            quantizedMinSumCheckNode(&prob_rates[begin], &like_rates[begin], end - begin, syndrome[i], qmax, shift);
+        }
+        // Recompute log-probability-ratios for the bits
+        for (auto j{0ULL}; j < this->matrix.cols(); j++)
+        {
+            auto pr{this->quant_channel[j]};
+            auto const begin{col_offsets[j]}, end{col_offsets[j + 1]};
+            for (auto k{begin}; k < end; k++)
+                pr += like_rates[col_edges[k]];
+            this->log_prob_ratios[j] = pr / this->llr_scale;
+            this->decide(j, pr <= 0);
+            for (auto k{begin}; k < end; k++)
+                prob_rates[col_edges[k]] = static_cast<Q>(::std::clamp(pr - like_rates[col_edges[k]], -qmax, qmax));
+        }
+    }
+    void BpDecoder::updateLayered(::std::span<uint8_t const> syndrome, int iter)
+    {
+        auto const row_offsets{this->matrix.rowOffsets()};
+        auto const edge_cols{this->matrix.edgeCols()};
+        auto *const prob_rates{this->prob_rates.data()};
+        auto *const like_rates{this->like_rates.data()};
+        // The posteriors are updated in place as soon as each row is processed.
+        auto &posteriors{this->log_prob_ratios};
+        double const alpha{1.0 - ::std::pow(0.5, iter + 1)};
+        for (auto i{0ULL}; i < this->matrix.rows(); i++)
+        {
+            auto const begin{row_offsets[i]}, end{row_offsets[i + 1]};
+            for (auto e{begin}; e < end; e++)
+                prob_rates[e] = posteriors[edge_cols[e]] - like_rates[e];
+            if (this->method == Method::MIN_SUM)
+                minSumCheckNode(prob_rates + begin, like_rates + begin, end - begin, syndrome[i], alpha);
+            else
+                sumProductCheckNode(prob_rates + begin, like_rates + begin, end - begin, syndrome[i], this->boxplus);
+            for (auto e{begin}; e < end; e++)
+                posteriors[edge_cols[e]] = prob_rates[e] + like_rates[e];
+        }
+        for (auto j{0ULL}; j < this->matrix.cols(); j++)
+            this->decide(j, posteriors[j] <= 0);
+    }
+    void BpDecoder::update(::std::span<uint8_t const> syndrome, int iter)
+    {
+        if (this->method == Method::QUANTIZED_MIN_SUM)
+        {
+            if (this->quant_bits <= 8)
+                this->updateQuantized(this->quant8_prob_rates, this->quant8_like_rates, syndrome, iter);
+            else
+                this->updateQuantized(this->quant16_prob_rates, this->quant16_like_rates, syndrome, iter);
+            return;
+        }
+
+        if (this->schedule == Schedule::LAYERED)
+            return this->updateLayered(syndrome, iter);
+
+        auto const &matrix{this->matrix};
+        auto &prob_rates{this->prob_rates};
+        auto &like_rates{this->like_rates};
+        auto &log_prob_ratios{this->log_prob_ratios};
+        auto const &channel_llrs{this->channel_llrs};
+        auto const row_offsets{matrix.rowOffsets()};
+        auto const col_offsets{matrix.colOffsets()};
+        auto const col_edges{matrix.colEdges()};
+        // Recompute likelihood ratios. Both methods work on LLR messages and share the bit-node pass.
+        if (method == Method::MIN_SUM)
         {
-            // Recompute likelihood ratios.
-            double dl, t;
-            for (auto i{0ULL}; i < matrix.row; i++)
+            double alpha{1.0 - ::std::pow(0.5, iter + 1)};
+            for (auto i{0ULL}; i < matrix.rows(); i++)
             {
-                dl = syndrome[i] ? -1 : 1;
-                auto const &row = matrix.items_each_row[i];
-                for (auto it{row.begin()}; it != row.end(); it++)
-                {
-                    (*it)->value.like_rate = dl;
-                    dl *= 2 / (1 + (*it)->value.prob_rate) - 1;
-                }
-                dl = 1;
-                for (auto it{row.rbegin()}; it != row.rend(); it++)
-                {
-                    t = (*it)->value.like_rate * dl;
-                    (*it)->value.like_rate = (1 - t) / (1 + t);
-                    dl *= 2 / (1 + (*it)->value.prob_rate) - 1;
-                }
+                auto const begin{row_offsets[i]}, end{row_offsets[i + 1]};
+                minSumCheckNode(&prob_rates[begin], &like_rates[begin], end - begin, syndrome[i], alpha);
             }
-
-            // Recompute probability ratios.  Also find the next guess based on the individually most likely values.
-            double pr;
-            for (auto j{0ULL}; j < matrix.col; j++)
+        }
+        else
+        {
+            for (auto i{0ULL}; i < matrix.rows(); i++)
             {
-                pr = prob_ratio_initial;
-                auto const &col = matrix.items_each_col[j];
-                for (auto it{col.begin()}; it != col.end(); it++)
-                {
-                    (*it)->value.prob_rate = pr;
-                    pr *= (*it)->value.like_rate;
-                }
-                if (::std::isnan(pr))
-                    pr = 1;
-                log_prob_ratios[j] = ::std::log(1 / pr);
-                decoding[j] = pr >= 1;
-                pr = 1;
-                for (auto it{col.rbegin()}; it != col.rend(); it++)
-                {
-                    (*it)->value.prob_rate *= pr;
-                    if (::std::isnan((*it)->value.prob_rate))
-                        (*it)->value.prob_rate = 1;
-                    pr *= (*it)->value.like_rate;
-                }
+                auto const begin{row_offsets[i]}, end{row_offsets[i + 1]};
+                sumProductCheckNode(&prob_rates[begin], &like_rates[begin], end - begin, syndrome[i], this->boxplus);
             }
         }
+        // Recompute log-probability-ratios for the bits
+        double pr;
+        for (auto j{0ULL}; j < matrix.cols(); j++)
+        {
+            pr = channel_llrs[j];
+            auto const begin{col_offsets[j]}, end{col_offsets[j + 1]};
+            for (auto k{begin}; k < end; k++)
+                pr += like_rates[col_edges[k]];
+            log_prob_ratios[j] = pr;
+            this->decide(j, pr <= 0);
+            for (auto k{end}; k-- > begin;)
+                prob_rates[col_edges[k]] = pr - like_rates[col_edges[k]];
+        }
+    }
+    BpDecoder::BpDecoder(::sparse_matrix::Mod2SparseMatrix const &matrix, Method method, double error_prob, int max_iter, Schedule schedule)
+        : matrix{matrix}, method{method}, schedule{schedule}, error_prob{error_prob}, max_iter{max_iter},
+          channel_llrs(matrix.cols(), ::std::log((1 - error_prob) / error_prob)),
+          quant_bits{8}, llr_scale{4.}, lookup{false},
+          prob_rates(method == Method::QUANTIZED_MIN_SUM ? 0 : matrix.edges()),
+          like_rates(method == Method::QUANTIZED_MIN_SUM ? 0 : matrix.edges()),
+          log_prob_ratios(matrix.cols()), best_log_prob_ratios(matrix.cols()),
+          decoding(matrix.cols()), bit_syndrome(matrix.rows()), residual_syndrome(matrix.rows()), unsatisfied{0}
+    {
+        if (!(error_prob > 0 && error_prob <= 0.5))
+            throw ::std::invalid_argument("Error probability must be in (0, 0.5]."s);
+        if (method == Method::QUANTIZED_MIN_SUM)
+            this->setQuantization(8, 4.);
+    }
+    void BpDecoder::setQuantization(int quant_bits, double llr_scale)
+    {
+        if (quant_bits < 2 || quant_bits > 16)
+            throw ::std::invalid_argument("Quantization bits must be in [2, 16]."s);
+        if (!(llr_scale > 0))
+            throw ::std::invalid_argument("LLR scale must be positive."s);
+        this->quant_bits = quant_bits;
+        this->llr_scale = llr_scale;
+        this->quantizeChannel();
+        auto const edges{this->method == Method::QUANTIZED_MIN_SUM ? this->matrix.edges() : 0};
+        this->quant8_prob_rates.assign(quant_bits <= 8 ? edges : 0, 0);
+        this->quant8_like_rates.assign(quant_bits <= 8 ? edges : 0, 0);
+        this->quant16_prob_rates.assign(quant_bits <= 8 ? 0 : edges, 0);
+        this->quant16_like_rates.assign(quant_bits <= 8 ? 0 : edges, 0);
+        this->quant_posteriors.assign(this->schedule == Schedule::LAYERED && edges ? this->matrix.cols() : 0, 0);
     }
-    size_t BpDecoder::hammingWeight(::std::vector<uint8_t> const &src1, ::std::vector<uint8_t> const &src2)
+    void BpDecoder::quantizeChannel()
     {
-        // assert(src1.size() == src2.size());
-        auto size = src1.size();
-        auto result{0ULL};
-        for (auto i{0ULL}; i < size; i++)
-            result += src1[i] ^ src2[i];
-        return result;
+        if (this->method != Method::QUANTIZED_MIN_SUM)
+            return;
+        double const qmax = (1 << (this->quant_bits - 1)) - 1;
+        this->quant_channel.resize(this->matrix.cols());
+        for (auto j{0ULL}; j < this->matrix.cols(); j++)
+            this->quant_channel[j] = static_cast<int32_t>(::std::clamp(::std::round(this->channel_llrs[j] * this->llr_scale), -qmax, qmax));
+    }
+    void BpDecoder::setErrorProb(double error_prob)
+    {
+        if (!(error_prob > 0 && error_prob <= 0.5))
+            throw ::std::invalid_argument("Error probability must be in (0, 0.5]."s);
+        auto const llr{::std::log((1 - error_prob) / error_prob)};
+        auto const was_uniform{::std::all_of(this->channel_llrs.begin(), this->channel_llrs.end(), [this](double old)
+                                             { return old == this->channel_llrs.front(); })};
+        this->error_prob = error_prob;
+        ::std::fill(this->channel_llrs.begin(), this->channel_llrs.end(), llr);
+        this->quantizeChannel();
+        if (this->lookup && !was_uniform)
+            this->buildLookup();
+    }
+    void BpDecoder::setPriors(::std::span<double const> error_probs)
+    {
+        if (error_probs.size() != this->matrix.cols())
+            throw ::std::invalid_argument("Priors length mismatch matrix col."s);
+        ::std::vector<double> llrs(error_probs.size());
+        for (auto j{0ULL}; j < error_probs.size(); j++)
+        {
+            auto const p{error_probs[j]};
+            if (!(p > 0 && p <= 0.5))
+                throw ::std::invalid_argument("Prior probabilities must be in (0, 0.5]."s);
+            llrs[j] = ::std::log((1 - p) / p);
+        }
+        this->setPriorLlrs(llrs);
     }
-    BpDecoder::BpDecoder(Method method, double error_prob, int max_iter)
-        : method{method}, error_prob{error_prob}, max_iter{max_iter} {}
-    ::std::tuple<size_t, bool, std::vector<double>, std::vector<uint8_t>> BpDecoder::run(::sparse_matrix::Mod2SparseMatrix matrix, ::std::vector<uint8_t> const &bit_error)
+    void BpDecoder::setPriorLlrs(::std::span<double const> log_prob_ratios)
     {
+        if (log_prob_ratios.size() != this->matrix.cols())
+            throw ::std::invalid_argument("Priors length mismatch matrix col."s);
+        if (!::std::all_of(log_prob_ratios.begin(), log_prob_ratios.end(), [](double llr)
+                           { return ::std::isfinite(llr) && llr >= 0; }))
+            throw ::std::invalid_argument("Prior LLRs must be finite and non-negative."s);
+        this->channel_llrs.assign(log_prob_ratios.begin(), log_prob_ratios.end());
+        this->quantizeChannel();
+        // The most likely corrections depend on the priors.
+        if (this->lookup)
+            this->buildLookup();
+    }
+    void BpDecoder::setSyndromeLookup(bool enabled)
+    {
+        this->lookup = enabled;
+        if (enabled)
+            this->buildLookup();
+        else
+        {
+            this->lookup_single.clear();
+            this->lookup_pair.clear();
+            this->lookup_column.clear();
+        }
+    }
+    void BpDecoder::setFlip(int max_steps)
+    {
+        this->flip.emplace(this->matrix, max_steps);
+    }
+    void BpDecoder::setOsd(OsdDecoder::Method method, int order)
+    {
+        this->osd.emplace(this->matrix, method, order);
+    }
+    BpDecoder::Result BpDecoder::decode(::std::span<uint8_t const> syndrome)
+    {
+        if (syndrome.size() != this->matrix.rows())
+            throw ::std::runtime_error("Syndrome length mismatch matrix row."s);
+        // Checks are read mod 2, as OSD, flip and the batch decoder do. Reduce other bytes once here so that the
+        // scan, init() and the check-node kernels all see 0 or 1.
+        if (::std::any_of(syndrome.begin(), syndrome.end(), [](uint8_t bit)
+                          { return bit > 1; }))
+        {
+            ::std::transform(syndrome.begin(), syndrome.end(), this->bit_syndrome.begin(), [](uint8_t bit)
+                             { return static_cast<uint8_t>(bit & 1); });
+            syndrome = this->bit_syndrome;
+        }
+        // Short-circuit trivial syndromes: the first two unsatisfied checks and the weight, stopping at three.
+        Index first{0}, second{0};
+        size_t weight{0};
+        for (auto i{0ULL}; i < syndrome.size() && weight < 3; i++)
+        {
+            if (!syndrome[i])
+                continue;
+            (weight == 0 ? first : second) = static_cast<Index>(i);
+            weight++;
+        }
+        if (weight == 0)
+            return this->shortCircuit({{0, 0}, 0});
+        if (this->lookup && weight == 1 && this->lookup_single[first].count)
+            return this->shortCircuit(this->lookup_single[first]);
+        if (this->lookup && weight == 2)
+        {
+            auto const found{this->lookup_pair.find(static_cast<uint64_t>(first) * this->matrix.rows() + second)};
+            Correction const disjoint{{this->lookup_column[first], this->lookup_column[second]}, 2};
+            auto const has_disjoint{disjoint.cols[0] != no_column && disjoint.cols[1] != no_column};
+            if (found != this->lookup_pair.end() && (!has_disjoint || this->cost(found->second) <= this->cost(disjoint)))
+                return this->shortCircuit(found->second);
+            if (has_disjoint)
+                return this->shortCircuit(disjoint);
+        }
         // setup
-        auto &&[prob_ratio_initial, log_prob_ratios, bit_syndrome, decoding] = this->init(matrix, bit_error);
+        this->init(syndrome);
         auto best_hamming_weight{SIZE_MAX};
-        ::std::vector<double> best_log_prob_ratios;
         auto has_decreased{false};
         // run
         for (auto it{0}; it < max_iter; it++)
         {
-            this->update(matrix, decoding, log_prob_ratios, bit_syndrome, prob_ratio_initial, it);
-            auto candidate_synd{this->getParityChecks(matrix, decoding)};
-            auto hamming_weight = this->hammingWeight(bit_syndrome, candidate_synd);
+            this->update(syndrome, it);
+            auto hamming_weight = this->unsatisfied;
             if (hamming_weight == 0)
-                return std::make_tuple(it, true, log_prob_ratios, decoding);
+                return {static_cast<size_t>(it), true, this->log_prob_ratios, this->decoding, false, false};
             if (hamming_weight < best_hamming_weight)
             {
                 best_hamming_weight = hamming_weight;
-                best_log_prob_ratios = log_prob_ratios;
+                this->best_log_prob_ratios = this->log_prob_ratios;
                 has_decreased = true;
             }
         }
-        if (has_decreased)
-            return std::make_tuple(max_iter, false, best_log_prob_ratios, decoding);
-        else
-            return std::make_tuple(max_iter, false, log_prob_ratios, decoding);
+        ::std::span<double const> soft_output{has_decreased ? this->best_log_prob_ratios : this->log_prob_ratios};
+        if (this->flip && this->flip->decode(syndrome, this->decoding, soft_output))
+            return {static_cast<size_t>(max_iter), false, soft_output, this->flip->result(), true, false};
+        if (this->osd && this->osd->decode(syndrome, soft_output, this->channel_llrs))
+            return {static_cast<size_t>(max_iter), false, soft_output, this->osd->result(), true, false};
+        return {static_cast<size_t>(max_iter), false, soft_output, this->decoding, false, false};
+    }
+    BpDecoder::Result BpDecoder::decode(::std::span<uint64_t const> packed_syndrome)
+    {
+        auto const rows{this->matrix.rows()};
+        if (packed_syndrome.size() != (rows + 63) / 64)
+            throw ::std::runtime_error("Packed syndrome length mismatch matrix row."s);
+        for (auto i{0ULL}; i < rows; i++)
+            this->bit_syndrome[i] = (packed_syndrome[i / 64] >> (i % 64)) & 1;
+        return this->decode(this->bit_syndrome);
+    }
+    BpDecoder::Result BpDecoder::decode(::sparse_matrix::Mod2Vector const &syndrome)
+    {
+        if (syndrome.size() != this->matrix.rows())
+            throw ::std::runtime_error("Syndrome length mismatch matrix row."s);
+        return this->decode(syndrome.words());
+    }
+    BpDecoder::Result BpDecoder::run(::std::span<uint8_t const> bit_error)
+    {
+        this->matrix.multiply(bit_error, this->bit_syndrome);
+        return this->decode(this->bit_syndrome);
     }
-}
\ No newline at end of file
+}
@@ -13,34 +13,145 @@
 #ifndef _BP_DECODER_HPP_
 #define _BP_DECODER_HPP_
 
+#include <span>
+#include <optional>
+#include <unordered_map>
+
 #include "sparse_matrix.hpp"
+#include "check_node.hpp"
+#include "osd_decoder.hpp"
+#include "flip_decoder.hpp"
 
 namespace bp_decoder
 {
+    // A decoder bound to one parity-check matrix. All message and scratch buffers are allocated once in the
+    // constructor, so repeated decode()/run() calls do not touch the heap.
     class BpDecoder
     {
     public: // types
         enum class Method
         {
             MIN_SUM,
-            PRODUCT_SUM
+            PRODUCT_SUM,
+            // Min-sum on saturating fixed-point messages, see setQuantization().
+            QUANTIZED_MIN_SUM
+        };
+        enum class Schedule
+        {
+            // Every check node, then every bit node, each iteration.
+            FLOODING,
+            // Row by row, refreshing the posteriors of a row's bits right after it is processed.
+            LAYERED
+        };
+        // Views into the decoder workspace, valid until the next decode()/run() call.
+        struct Result
+        {
+            size_t iter;
+            bool converge;
+            ::std::span<double const> log_prob_ratios;
+            ::std::span<uint8_t const> decoding;
+            // BP did not converge and the decoding comes from a post-processor, see setFlip() and setOsd().
+            bool post_processed;
+            // BP did not run and the decoding comes from the syndrome lookup table, see setSyndromeLookup().
+            bool looked_up;
+        };
+
+    private: // types
+        using Index = ::sparse_matrix::Mod2SparseMatrix::Index;
+        static constexpr Index no_column{UINT32_MAX};
+        // A correction of at most two bits, count of 0 meaning none.
+        struct Correction
+        {
+            Index cols[2];
+            uint8_t count;
         };
 
     private: // vars
+        ::sparse_matrix::Mod2SparseMatrix matrix;
         Method method;
+        Schedule schedule;
         double error_prob;
         int max_iter;
+        // Channel LLR log((1 - p_j) / p_j) of every bit, uniform unless setPriors() was called. Also the OSD costs.
+        ::std::vector<double> channel_llrs;
+        BoxplusTable boxplus;
+        // Fixed-point format of QUANTIZED_MIN_SUM: messages are round(llr * llr_scale) saturated to `quant_bits`.
+        int quant_bits;
+        double llr_scale;
+        ::std::vector<int32_t> quant_channel; // channel_llrs in the fixed-point format
+        // Run when BP stops without converging: small-set-flip first, then OSD if it is still unsatisfied.
+        ::std::optional<FlipDecoder> flip;
+        ::std::optional<OsdDecoder> osd;
+        // Cheapest corrections of at most two bits for every weight-1 syndrome (by row) and weight-2 syndrome (by
+        // row pair key); empty unless setSyndromeLookup(true). lookup_pair only holds pairs of bits sharing a check
+        // and single weight-2 bits: two weight-1 bits of distinct checks are combined from lookup_column at decode
+        // time instead of storing every such pair.
+        ::std::vector<Correction> lookup_single;
+        ::std::unordered_map<uint64_t, Correction> lookup_pair;
+        ::std::vector<Index> lookup_column; // cheapest weight-1 column of every row, no_column if none
+        bool lookup;
+
+    private: // workspace
+        // LLR messages in flat arrays indexed by edge id: prob_rates flow bit -> check, like_rates flow check -> bit.
+        ::std::vector<double> prob_rates, like_rates;
+        // QUANTIZED_MIN_SUM stores messages as int8 up to 8 bits and as int16 above.
+        ::std::vector<int8_t> quant8_prob_rates, quant8_like_rates;
+        ::std::vector<int16_t> quant16_prob_rates, quant16_like_rates;
+        ::std::vector<int32_t> quant_posteriors; // layered schedule only
+        ::std::vector<double> log_prob_ratios, best_log_prob_ratios;
+        ::std::vector<uint8_t> decoding, bit_syndrome;
+        // syndrome ^ H * decoding, kept up to date as hard decisions flip, and its weight.
+        ::std::vector<uint8_t> residual_syndrome;
+        size_t unsatisfied;
 
     private: // utils
-        auto getParityChecks(::sparse_matrix::Mod2SparseMatrix const &matrix, ::std::vector<uint8_t> const &code_word);
-        auto init(::sparse_matrix::Mod2SparseMatrix &matrix, ::std::vector<uint8_t> const &bit_error);
-        void update(::sparse_matrix::Mod2SparseMatrix &matrix, ::std::vector<uint8_t> &decoding, ::std::vector<double> &log_prob_ratios, ::std::vector<uint8_t> const &syndrome, double prob_ratio_initial, int iter);
-        size_t hammingWeight(::std::vector<uint8_t> const &src1, ::std::vector<uint8_t> const &src2);
+        void init(::std::span<uint8_t const> syndrome);
+        // Result that flips exactly the bits of `correction`, without running BP; counts as converged only for
+        // the zero syndrome and as looked up otherwise.
+        Result shortCircuit(Correction const &correction);
+        // Negative log-likelihood of a correction up to a constant: the sum of its channel LLRs.
+        double cost(Correction const &correction) const;
+        void buildLookup();
+        void quantizeChannel();
+        // Set a hard decision, updating the residual syndrome in O(column weight) when it flips.
+        void decide(size_t col, uint8_t bit);
+        void update(::std::span<uint8_t const> syndrome, int iter);
+        void updateLayered(::std::span<uint8_t const> syndrome, int iter);
+        template <typename Q>
+        void updateQuantized(::std::vector<Q> &prob_rates, ::std::vector<Q> &like_rates, ::std::span<uint8_t const> syndrome, int iter);
 
     public: // apis
-        BpDecoder(Method method, double error_prob, int max_iter);
-        ::std::tuple<size_t, bool, std::vector<double>, std::vector<uint8_t>> run(::sparse_matrix::Mod2SparseMatrix matrix, ::std::vector<uint8_t> const &bit_error);
+        BpDecoder(::sparse_matrix::Mod2SparseMatrix const &matrix, Method method, double error_prob, int max_iter, Schedule schedule = Schedule::FLOODING);
+        // Fixed-point format for QUANTIZED_MIN_SUM; bits in [2, 16], defaults to 8 bits with scale 4.
+        void setQuantization(int quant_bits, double llr_scale);
+        // Switch to a uniform error_prob in (0, 0.5], as for the priors below, e.g. between points of a sweep,
+        // without rebuilding anything else. The lookup table is kept when the old channel was uniform too, since
+        // every correction then costs its weight times the same LLR and the ranking cannot change.
+        void setErrorProb(double error_prob);
+        // Per-column priors in place of the uniform error_prob, for noise models where every bit has its own
+        // probability: either probabilities in (0, 0.5], converted once to LLRs, or the LLRs log((1 - p) / p) >= 0.
+        // A bit more likely flipped than not would have a negative cost, making heavier corrections cheaper than
+        // the lookup table and OSD's low-order search assume; fold such a bit into the syndrome and pass 1 - p.
+        void setPriors(::std::span<double const> error_probs);
+        void setPriorLlrs(::std::span<double const> log_prob_ratios);
+        // Answer weight-1 and weight-2 syndromes with the cheapest correction of at most two bits, built from the
+        // matrix, falling back to BP when no such correction exists. Under uniform priors that is a correction of
+        // fewest bits; under per-column priors a heavier correction can still be more likely. Zero syndromes
+        // always return immediately.
+        void setSyndromeLookup(bool enabled);
+        // Enable the small-set-flip fallback, at most `max_steps` flips per shot.
+        void setFlip(int max_steps);
+        // Enable BP+OSD: on non-convergence, OSD of the given method and order runs on the best soft output.
+        void setOsd(OsdDecoder::Method method, int order);
+        // Decode a syndrome of length matrix.rows() (one byte per check, read mod 2).
+        Result decode(::std::span<uint8_t const> syndrome);
+        // Decode a bit-packed syndrome: check i is bit (i % 64) of word i / 64, ceil(rows / 64) words in total.
+        // A convenience for packed callers: the syndrome is unpacked into bytes first, so this is no faster.
+        Result decode(::std::span<uint64_t const> packed_syndrome);
+        Result decode(::sparse_matrix::Mod2Vector const &syndrome);
+        // Decode the syndrome of `bit_error` (one byte per bit).
+        Result run(::std::span<uint8_t const> bit_error);
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,137 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#pragma once
+
+#ifndef _CHECK_NODE_HPP_
+#define _CHECK_NODE_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <array>
+
+namespace bp_decoder
+{
+    // Min-sum check-node update over the `weight` bit->check messages `in` of one row.
+    // Writes the extrinsic check->bit messages to `out`. The sign is tracked as an XOR parity (a message <= 0
+    // counts as a 1), and the magnitude is the row minimum, or the second minimum at the argmin edge, so ties
+    // are resolved by position rather than by a floating-point comparison.
+    inline void minSumCheckNode(double const *in, double *out, size_t weight, uint32_t syndrome_bit, double alpha)
+    {
+        auto min1{::std::numeric_limits<double>::infinity()}, min2{min1};
+        size_t argmin{0};
+        auto parity{syndrome_bit};
+        for (size_t k{0}; k < weight; k++)
+        {
+            auto const abs_in{::std::fabs(in[k])};
+            auto const less{abs_in < min1};
+            min2 = less ? min1 : ::std::min(min2, abs_in);
+            min1 = less ? abs_in : min1;
+            argmin = less ? k : argmin;
+            parity ^= static_cast<uint32_t>(in[k] <= 0);
+        }
+        min1 *= alpha;
+        min2 *= alpha;
+        for (size_t k{0}; k < weight; k++)
+        {
+            auto const magnitude{k == argmin ? min2 : min1};
+            auto const negative{parity ^ static_cast<uint32_t>(in[k] <= 0)};
+            out[k] = negative ? -magnitude : magnitude;
+        }
+    }
+
+    // Fixed-point min-sum check node on messages saturated to [-qmax, qmax].
+    // The damping alpha = 1 - 2^-shift is applied as m - (m >> shift), exactly as in hardware.
+    template <typename Q>
+    inline void quantizedMinSumCheckNode(Q const *in, Q *out, size_t weight, uint32_t syndrome_bit, int32_t qmax, int shift)
+    {
+        int32_t min1{qmax}, min2{qmax};
+        size_t argmin{0};
+        auto parity{syndrome_bit};
+        for (size_t k{0}; k < weight; k++)
+        {
+            int32_t const value{in[k]};
+            auto const abs_in{value < 0 ? -value : value};
+            auto const less{abs_in < min1};
+            min2 = less ? min1 : ::std::min(min2, abs_in);
+            min1 = less ? abs_in : min1;
+            argmin = less ? k : argmin;
+            parity ^= static_cast<uint32_t>(value <= 0);
+        }
+        min1 -= min1 >> shift;
+        min2 -= min2 >> shift;
+        for (size_t k{0}; k < weight; k++)
+        {
+            auto const magnitude{k == argmin ? min2 : min1};
+            auto const negative{parity ^ static_cast<uint32_t>(in[k] <= 0)};
+            out[k] = static_cast<Q>(negative ? -magnitude : magnitude);
+        }
+    }
+
+    // Exact LLR-domain boxplus, a [+] b = 2 atanh(tanh(a / 2) tanh(b / 2)), evaluated as
+    // sign(a) sign(b) (min(|a|, |b|) + log(1 + e^-(|a| + |b|)) - log(1 + e^-||a| - |b||)).
+    // The correction term is bounded by log 2 and smooth, so a linearly interpolated table is accurate over
+    // its whole range; there is no division and nothing can overflow to NaN.
+    class BoxplusTable
+    {
+    public: // consts
+        static constexpr double step{1. / 32}, limit{16.};
+        // Stands in for the boxplus identity (+infinity) while keeping every message finite.
+        static constexpr double identity{1e6};
+
+    private: // vars
+        ::std::array<double, static_cast<size_t>(limit / step) + 2> table;
+
+    public: // apis
+        BoxplusTable()
+        {
+            for (size_t i{0}; i < table.size(); i++)
+                table[i] = ::std::log1p(::std::exp(-static_cast<double>(i) * step));
+        }
+        // log(1 + e^-x) for x >= 0.
+        double correction(double x) const
+        {
+            if (!(x < limit))
+                return 0.;
+            auto const pos{x * (1 / step)};
+            auto const index{static_cast<size_t>(pos)};
+            return table[index] + (pos - static_cast<double>(index)) * (table[index + 1] - table[index]);
+        }
+        double operator()(double a, double b) const
+        {
+            auto const abs_a{::std::fabs(a)}, abs_b{::std::fabs(b)};
+            auto const magnitude{::std::max(0., ::std::min(abs_a, abs_b) + correction(abs_a + abs_b) - correction(::std::fabs(abs_a - abs_b)))};
+            return ((a < 0) != (b < 0)) ? -magnitude : magnitude;
+        }
+    };
+
+    // Sum-product check-node update in the LLR domain, same calling convention as minSumCheckNode.
+    // A forward pass leaves the exclusive prefix boxplus in `out`; the backward pass folds in the suffix.
+    inline void sumProductCheckNode(double const *in, double *out, size_t weight, uint32_t syndrome_bit, BoxplusTable const &boxplus)
+    {
+        auto acc{BoxplusTable::identity};
+        for (size_t k{0}; k < weight; k++)
+        {
+            out[k] = acc;
+            acc = boxplus(acc, in[k]);
+        }
+        acc = syndrome_bit ? -BoxplusTable::identity : BoxplusTable::identity;
+        for (size_t k{weight}; k-- > 0;)
+        {
+            out[k] = boxplus(out[k], acc);
+            acc = boxplus(acc, in[k]);
+        }
+    }
+}
+
+#endif
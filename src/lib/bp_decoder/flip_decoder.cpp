@@ -0,0 +1,136 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#include "flip_decoder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace bp_decoder
+{
+    int FlipDecoder::flipGain(size_t j) const
+    {
+        auto const col_offsets{this->matrix.colOffsets()};
+        auto const col_rows{this->matrix.colRows()};
+        int gain{0};
+        for (auto k{col_offsets[j]}; k < col_offsets[j + 1]; k++)
+            gain += this->residual_syndrome[col_rows[k]] ? 1 : -1;
+        return gain;
+    }
+    int FlipDecoder::sharedBalance(size_t a, size_t b) const
+    {
+        auto const col_offsets{this->matrix.colOffsets()};
+        auto const col_rows{this->matrix.colRows()};
+        // Column lists are sorted by row, so a merge walk finds the shared checks.
+        int balance{0};
+        auto p{col_offsets[a]}, q{col_offsets[b]};
+        while (p < col_offsets[a + 1] && q < col_offsets[b + 1])
+        {
+            if (col_rows[p] < col_rows[q])
+                p++;
+            else if (col_rows[q] < col_rows[p])
+                q++;
+            else
+            {
+                balance += this->residual_syndrome[col_rows[p]] ? 1 : -1;
+                p++;
+                q++;
+            }
+        }
+        return balance;
+    }
+    void FlipDecoder::flip(size_t j)
+    {
+        auto const col_offsets{this->matrix.colOffsets()};
+        auto const col_rows{this->matrix.colRows()};
+        this->decoding[j] ^= 1;
+        for (auto k{col_offsets[j]}; k < col_offsets[j + 1]; k++)
+        {
+            auto &residual{this->residual_syndrome[col_rows[k]]};
+            residual ^= 1;
+            this->unsatisfied += residual ? 1 : -1;
+        }
+    }
+    FlipDecoder::FlipDecoder(::sparse_matrix::Mod2SparseMatrix const &matrix, int max_steps)
+        : matrix{matrix}, max_steps{max_steps},
+          decoding(matrix.cols()), residual_syndrome(matrix.rows()), unsatisfied{0}
+    {
+        if (max_steps <= 0)
+            throw ::std::invalid_argument("Flip steps must be positive."s);
+    }
+    bool FlipDecoder::decode(::std::span<uint8_t const> syndrome, ::std::span<uint8_t const> decoding, ::std::span<double const> log_prob_ratios)
+    {
+        if (syndrome.size() != this->matrix.rows())
+            throw ::std::runtime_error("Syndrome length mismatch matrix row."s);
+        if (decoding.size() != this->matrix.cols() || log_prob_ratios.size() != this->matrix.cols())
+            throw ::std::runtime_error("Decoding length mismatch matrix col."s);
+        auto const row_offsets{this->matrix.rowOffsets()};
+        auto const edge_cols{this->matrix.edgeCols()};
+
+        ::std::copy(decoding.begin(), decoding.end(), this->decoding.begin());
+        this->matrix.multiply(this->decoding, this->residual_syndrome);
+        this->unsatisfied = 0;
+        for (auto i{0ULL}; i < this->matrix.rows(); i++)
+        {
+            this->residual_syndrome[i] ^= syndrome[i] & 1;
+            this->unsatisfied += this->residual_syndrome[i];
+        }
+
+        // Flipping a bit currently decided 0 goes against a positive LLR, and vice versa.
+        auto const flipCost = [&](size_t j)
+        { return this->decoding[j] ? -log_prob_ratios[j] : log_prob_ratios[j]; };
+        // gain / size compared by cross-multiplication, then the cheaper set.
+        auto const better = [](Candidate const &a, Candidate const &b)
+        {
+            auto const lhs{a.gain * b.size}, rhs{b.gain * a.size};
+            return lhs != rhs ? lhs > rhs : a.cost < b.cost;
+        };
+
+        for (auto step{0}; step < this->max_steps && this->unsatisfied; step++)
+        {
+            Candidate best{0, 1, 0., {0, 0}};
+            for (auto i{0ULL}; i < this->matrix.rows(); i++)
+            {
+                if (!this->residual_syndrome[i])
+                    continue;
+                // Any flip that lowers the syndrome weight touches an unsatisfied check, so sets within the
+                // support of one are enough.
+                auto const begin{row_offsets[i]}, end{row_offsets[i + 1]};
+                this->gains.resize(end - begin);
+                for (auto e{begin}; e < end; e++)
+                {
+                    auto const j{edge_cols[e]};
+                    this->gains[e - begin] = this->flipGain(j);
+                    Candidate single{this->gains[e - begin], 1, flipCost(j), {j, j}};
+                    if (better(single, best))
+                        best = single;
+                }
+                for (auto e{begin}; e < end; e++)
+                {
+                    for (auto f{e + 1}; f < end; f++)
+                    {
+                        auto const a{edge_cols[e]}, b{edge_cols[f]};
+                        // Checks shared by both bits are flipped twice and stay as they are.
+                        auto const gain{this->gains[e - begin] + this->gains[f - begin] - 2 * this->sharedBalance(a, b)};
+                        Candidate pair{gain, 2, flipCost(a) + flipCost(b), {a, b}};
+                        if (better(pair, best))
+                            best = pair;
+                    }
+                }
+            }
+            if (best.gain <= 0)
+                break;
+            this->flip(best.cols[0]);
+            if (best.size == 2)
+                this->flip(best.cols[1]);
+        }
+        return this->unsatisfied == 0;
+    }
+}
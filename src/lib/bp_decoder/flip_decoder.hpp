@@ -0,0 +1,64 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#pragma once
+
+#ifndef _FLIP_DECODER_HPP_
+#define _FLIP_DECODER_HPP_
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include "sparse_matrix.hpp"
+
+namespace bp_decoder
+{
+    // Small-set-flip post-processing: starting from the BP hard decision, repeatedly flip the set of at most
+    // two bits sharing an unsatisfied check that removes the most unsatisfied checks per flipped bit.
+    // Ties go to the set BP considers most likely flipped. Every step lowers the syndrome weight, and the
+    // number of steps is capped, so the latency is bounded by a few scans of the unsatisfied rows.
+    class FlipDecoder
+    {
+    private: // types
+        struct Candidate
+        {
+            int gain;    // decrease in syndrome weight
+            int size;    // bits flipped
+            double cost; // sum of signed LLRs against the flip, lower is more likely
+            uint32_t cols[2];
+        };
+
+    private: // vars
+        ::sparse_matrix::Mod2SparseMatrix matrix;
+        int max_steps;
+
+    private: // workspace
+        ::std::vector<uint8_t> decoding, residual_syndrome;
+        ::std::vector<int> gains; // per bit of the row being scanned
+        size_t unsatisfied;
+
+    private: // utils
+        // Syndrome-weight decrease from flipping column j alone.
+        int flipGain(size_t j) const;
+        // Checks shared by columns a and b that are currently unsatisfied, minus those satisfied.
+        int sharedBalance(size_t a, size_t b) const;
+        void flip(size_t j);
+
+    public: // apis
+        FlipDecoder(::sparse_matrix::Mod2SparseMatrix const &matrix, int max_steps);
+        // Refine `decoding` towards H e = syndrome, breaking ties with `log_prob_ratios`.
+        // Returns whether the syndrome is satisfied; result() holds the refined decoding either way.
+        bool decode(::std::span<uint8_t const> syndrome, ::std::span<uint8_t const> decoding, ::std::span<double const> log_prob_ratios);
+        ::std::span<uint8_t const> result() const { return this->decoding; }
+    };
+}
+
+#endif
@@ -0,0 +1,245 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#include "osd_decoder.hpp"
+
+#include <bit>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+namespace bp_decoder
+{
+    void OsdDecoder::eliminate(::std::span<uint8_t const> syndrome, ::std::span<double const> log_prob_ratios)
+    {
+        auto const row_count{this->matrix.rows()}, col_count{this->matrix.cols()};
+        auto const row_offsets{this->matrix.rowOffsets()};
+        auto const edge_cols{this->matrix.edgeCols()};
+        auto const words{this->row_words};
+
+        // Most likely flipped first; ties by column so the order is deterministic.
+        ::std::iota(this->order_to_col.begin(), this->order_to_col.end(), 0);
+        ::std::sort(this->order_to_col.begin(), this->order_to_col.end(), [&](Index a, Index b)
+                    { return log_prob_ratios[a] < log_prob_ratios[b] || (log_prob_ratios[a] == log_prob_ratios[b] && a < b); });
+        for (auto pos{0ULL}; pos < col_count; pos++)
+            this->col_to_order[this->order_to_col[pos]] = static_cast<Index>(pos);
+
+        ::std::fill(this->rows.begin(), this->rows.end(), 0);
+        for (auto i{0ULL}; i < row_count; i++)
+        {
+            auto *const row{&this->rows[i * words]};
+            for (auto e{row_offsets[i]}; e < row_offsets[i + 1]; e++)
+            {
+                auto const pos{this->col_to_order[edge_cols[e]]};
+                row[pos / 64] |= uint64_t{1} << (pos % 64);
+            }
+            row[col_count / 64] |= static_cast<uint64_t>(syndrome[i] & 1) << (col_count % 64);
+        }
+
+        // Gauss-Jordan elimination, one word-parallel row XOR per eliminated entry.
+        this->rank = 0;
+        this->pivots.clear();
+        this->free_cols.clear();
+        for (auto pos{0ULL}; pos < col_count; pos++)
+        {
+            auto const word{pos / 64};
+            auto const mask{uint64_t{1} << (pos % 64)};
+            auto r{this->rank};
+            while (r < row_count && !(this->rows[r * words + word] & mask))
+                r++;
+            if (r == row_count)
+            {
+                this->free_cols.push_back(static_cast<Index>(pos));
+                continue;
+            }
+            auto *const pivot{&this->rows[this->rank * words]};
+            if (r != this->rank)
+                ::std::swap_ranges(pivot, pivot + words, &this->rows[r * words]);
+            for (auto i{0ULL}; i < row_count; i++)
+            {
+                auto *const row{&this->rows[i * words]};
+                if (i != this->rank && (row[word] & mask))
+                    for (auto w{0ULL}; w < words; w++)
+                        row[w] ^= pivot[w];
+            }
+            this->pivots.push_back(static_cast<Index>(pos));
+            this->rank++;
+        }
+    }
+    void OsdDecoder::extractFreeColumns(size_t count)
+    {
+        auto const words{this->row_words};
+        this->free_columns.assign(count * this->rank_words, 0);
+        for (auto k{0ULL}; k < this->rank; k++)
+        {
+            auto const *const row{&this->rows[k * words]};
+            auto const bit{uint64_t{1} << (k % 64)};
+            for (auto q{0ULL}; q < count; q++)
+            {
+                auto const pos{this->free_cols[q]};
+                if (row[pos / 64] >> (pos % 64) & 1)
+                    this->free_columns[q * this->rank_words + k / 64] |= bit;
+            }
+        }
+    }
+    double OsdDecoder::pivotCost(uint64_t const *bits) const
+    {
+        double cost{0.};
+        for (auto w{0ULL}; w < this->rank_words; w++)
+            for (auto word{bits[w]}; word; word &= word - 1)
+                cost += this->pivot_costs[w * 64 + ::std::countr_zero(word)];
+        return cost;
+    }
+    void OsdDecoder::emit(uint64_t const *bits)
+    {
+        ::std::fill(this->decoding.begin(), this->decoding.end(), 0);
+        for (auto k{0ULL}; k < this->rank; k++)
+            this->decoding[this->order_to_col[this->pivots[k]]] = bits[k / 64] >> (k % 64) & 1;
+        for (auto pos : this->flipped)
+            this->decoding[this->order_to_col[pos]] = 1;
+    }
+    void OsdDecoder::searchExhaustive(::std::span<double const> costs, size_t count)
+    {
+        this->extractFreeColumns(count);
+        auto const words{this->rank_words};
+        this->candidate = this->base;
+        auto best_cost{this->pivotCost(this->base.data())};
+        uint64_t best_pattern{0};
+        // Gray-code walk: consecutive patterns differ in one column, so each step is one packed XOR.
+        auto flip_cost{0.};
+        for (uint64_t g{1}; g < uint64_t{1} << count; g++)
+        {
+            auto const q{static_cast<size_t>(::std::countr_zero(g))};
+            auto const pattern{g ^ (g >> 1)};
+            auto const *const column{&this->free_columns[q * words]};
+            for (auto w{0ULL}; w < words; w++)
+                this->candidate[w] ^= column[w];
+            auto const cost{costs[this->order_to_col[this->free_cols[q]]]};
+            flip_cost += (pattern >> q & 1) ? cost : -cost;
+            auto const total{flip_cost + this->pivotCost(this->candidate.data())};
+            if (total < best_cost)
+            {
+                best_cost = total;
+                best_pattern = pattern;
+            }
+        }
+        this->candidate = this->base;
+        this->flipped.clear();
+        for (auto q{0ULL}; q < count; q++)
+        {
+            if (!(best_pattern >> q & 1))
+                continue;
+            for (auto w{0ULL}; w < words; w++)
+                this->candidate[w] ^= this->free_columns[q * words + w];
+            this->flipped.push_back(this->free_cols[q]);
+        }
+        this->emit(this->candidate.data());
+    }
+    void OsdDecoder::searchCombination(::std::span<double const> costs, size_t count)
+    {
+        auto const free_count{this->free_cols.size()};
+        this->extractFreeColumns(free_count);
+        auto const words{this->rank_words};
+        auto const free_cost = [&](size_t q)
+        { return costs[this->order_to_col[this->free_cols[q]]]; };
+        auto best_cost{this->pivotCost(this->base.data())};
+        auto best_a{SIZE_MAX}, best_b{SIZE_MAX};
+        // The free columns alone bound a candidate from below only if no pivot can lower its cost.
+        auto const prunable{::std::all_of(costs.begin(), costs.end(), [](double cost)
+                                          { return cost >= 0; })};
+        auto evaluate = [&](size_t a, size_t b)
+        {
+            auto total{free_cost(a) + (b == SIZE_MAX ? 0. : free_cost(b))};
+            if (prunable && total >= best_cost)
+                return; // cannot win whatever the pivots cost
+            for (auto w{0ULL}; w < words; w++)
+            {
+                auto word{this->base[w] ^ this->free_columns[a * words + w]};
+                if (b != SIZE_MAX)
+                    word ^= this->free_columns[b * words + w];
+                this->candidate[w] = word;
+            }
+            total += this->pivotCost(this->candidate.data());
+            if (total < best_cost)
+            {
+                best_cost = total;
+                best_a = a;
+                best_b = b;
+            }
+        };
+        for (auto a{0ULL}; a < free_count; a++)
+            evaluate(a, SIZE_MAX);
+        for (auto a{0ULL}; a < count; a++)
+            for (auto b{a + 1}; b < count; b++)
+                evaluate(a, b);
+
+        this->candidate = this->base;
+        this->flipped.clear();
+        for (auto q : {best_a, best_b})
+        {
+            if (q == SIZE_MAX)
+                continue;
+            for (auto w{0ULL}; w < words; w++)
+                this->candidate[w] ^= this->free_columns[q * words + w];
+            this->flipped.push_back(this->free_cols[q]);
+        }
+        this->emit(this->candidate.data());
+    }
+    OsdDecoder::OsdDecoder(::sparse_matrix::Mod2SparseMatrix const &matrix, Method method, int order)
+        : matrix{matrix}, method{method}, order{order},
+          row_words{::sparse_matrix::Mod2Vector::wordsFor(matrix.cols() + 1)},
+          rows(matrix.rows() * row_words), order_to_col(matrix.cols()), col_to_order(matrix.cols()),
+          decoding(matrix.cols()), rank{0}, rank_words{0}
+    {
+        if (order < 0)
+            throw ::std::invalid_argument("OSD order must be non-negative."s);
+        if (method == Method::OSD_E && order > max_exhaustive_order)
+            throw ::std::invalid_argument("OSD-E order must not exceed "s + ::std::to_string(max_exhaustive_order) + "."s);
+        this->pivots.reserve(::std::min(matrix.rows(), matrix.cols()));
+        this->free_cols.reserve(matrix.cols());
+    }
+    bool OsdDecoder::decode(::std::span<uint8_t const> syndrome, ::std::span<double const> log_prob_ratios, ::std::span<double const> costs)
+    {
+        auto const row_count{this->matrix.rows()}, col_count{this->matrix.cols()};
+        if (syndrome.size() != row_count)
+            throw ::std::runtime_error("Syndrome length mismatch matrix row."s);
+        if (log_prob_ratios.size() != col_count || costs.size() != col_count)
+            throw ::std::runtime_error("Soft input length mismatch matrix col."s);
+
+        this->eliminate(syndrome, log_prob_ratios);
+        // Rows left over after elimination are zero in H, so the syndrome must be zero there as well.
+        auto const words{this->row_words};
+        for (auto i{this->rank}; i < row_count; i++)
+            if (this->rows[i * words + col_count / 64] >> (col_count % 64) & 1)
+                return false;
+
+        this->rank_words = ::sparse_matrix::Mod2Vector::wordsFor(this->rank);
+        this->base.assign(this->rank_words, 0);
+        this->candidate.resize(this->rank_words);
+        this->pivot_costs.resize(this->rank);
+        for (auto k{0ULL}; k < this->rank; k++)
+        {
+            this->base[k / 64] |= (this->rows[k * words + col_count / 64] >> (col_count % 64) & 1) << (k % 64);
+            this->pivot_costs[k] = costs[this->order_to_col[this->pivots[k]]];
+        }
+
+        auto const count{::std::min(static_cast<size_t>(this->order), this->free_cols.size())};
+        if (this->method == Method::OSD_E && count > 0)
+            this->searchExhaustive(costs, count);
+        else if (this->method == Method::OSD_CS && !this->free_cols.empty())
+            this->searchCombination(costs, count);
+        else
+        {
+            this->flipped.clear();
+            this->emit(this->base.data());
+        }
+        return true;
+    }
+}
@@ -0,0 +1,88 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#pragma once
+
+#ifndef _OSD_DECODER_HPP_
+#define _OSD_DECODER_HPP_
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include "sparse_matrix.hpp"
+
+namespace bp_decoder
+{
+    // Ordered-statistics post-processing for syndromes BP could not satisfy.
+    // Columns are ordered from the most to the least likely to be in error by the soft output of BP, and a
+    // bit-packed copy of [H | s] in that order is brought to reduced row echelon form. The pivot columns form
+    // the information set; OSD-0 sets them to the eliminated syndrome and everything else to zero. Higher
+    // orders also flip test patterns on the first non-pivot columns and keep the solution of lowest cost.
+    // The packed matrix and all scratch buffers are reused across shots.
+    class OsdDecoder
+    {
+    public: // types
+        enum class Method
+        {
+            OSD_0,
+            // Exhaustive: all 2^order patterns over the first `order` non-pivot columns.
+            OSD_E,
+            // Combination sweep: every weight-1 pattern, plus the weight-2 patterns over the first `order`.
+            OSD_CS
+        };
+        using Index = ::sparse_matrix::Mod2SparseMatrix::Index;
+
+    public: // consts
+        static constexpr int max_exhaustive_order{24};
+
+    private: // vars
+        ::sparse_matrix::Mod2SparseMatrix matrix;
+        Method method;
+        int order;
+        size_t row_words; // words per packed row, the syndrome is column cols()
+
+    private: // workspace
+        ::std::vector<uint64_t> rows;         // rows() * row_words, columns in reliability order
+        ::std::vector<Index> order_to_col;    // reliability position -> column
+        ::std::vector<Index> col_to_order;    // column -> reliability position
+        ::std::vector<Index> pivots;          // pivot position of each eliminated row
+        ::std::vector<Index> free_cols;       // non-pivot positions in reliability order
+        ::std::vector<uint64_t> base;         // OSD-0 pivot values, packed over the rank
+        ::std::vector<uint64_t> free_columns; // eliminated non-pivot columns used by the search, packed over the rank
+        ::std::vector<uint64_t> candidate;
+        ::std::vector<double> pivot_costs;
+        ::std::vector<Index> flipped;         // non-pivot positions of the best pattern
+        ::std::vector<uint8_t> decoding;
+        size_t rank, rank_words;
+
+    private: // utils
+        void eliminate(::std::span<uint8_t const> syndrome, ::std::span<double const> log_prob_ratios);
+        void extractFreeColumns(size_t count);
+        // Cost of the pivot assignment in `bits` (rank_words words).
+        double pivotCost(uint64_t const *bits) const;
+        // Write the decoding for pivot assignment `bits` plus the non-pivot positions in `flipped`.
+        void emit(uint64_t const *bits);
+        void searchExhaustive(::std::span<double const> costs, size_t count);
+        void searchCombination(::std::span<double const> costs, size_t count);
+
+    public: // apis
+        // `order` is ignored by OSD_0 and limited to max_exhaustive_order for OSD_E.
+        OsdDecoder(::sparse_matrix::Mod2SparseMatrix const &matrix, Method method, int order);
+        // Solve H e = syndrome guided by `log_prob_ratios` (BP posteriors, negative = likely flipped), weighing
+        // candidates by `costs` (per-column log((1 - p) / p) of the channel).
+        // Returns false, leaving the output untouched, when the syndrome is not in the column space of H.
+        bool decode(::std::span<uint8_t const> syndrome, ::std::span<double const> log_prob_ratios, ::std::span<double const> costs);
+        // The last successful decoding, one byte per bit.
+        ::std::span<uint8_t const> result() const { return this->decoding; }
+    };
+}
+
+#endif
@@ -0,0 +1,165 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#include "code_construction.hpp"
+
+#include <vector>
+
+namespace sparse_matrix
+{
+    using Index = Mod2SparseMatrix::Index;
+
+    Mod2SparseMatrix transpose(Mod2SparseMatrix const &matrix)
+    {
+        auto const col_offsets{matrix.colOffsets()}, col_rows{matrix.colRows()};
+        return Mod2SparseMatrix(matrix.cols(), matrix.rows(),
+                                {col_offsets.begin(), col_offsets.end()}, {col_rows.begin(), col_rows.end()});
+    }
+    Mod2SparseMatrix kron(Mod2SparseMatrix const &a, Mod2SparseMatrix const &b)
+    {
+        auto const a_offsets{a.rowOffsets()}, a_cols{a.edgeCols()};
+        auto const b_offsets{b.rowOffsets()}, b_cols{b.edgeCols()};
+        auto const edges{a.edges() * b.edges()};
+        if (a.rows() * b.rows() > UINT32_MAX || a.cols() * b.cols() > UINT32_MAX || edges > UINT32_MAX)
+            throw ::std::runtime_error("Matrix too large for 32-bit edge index."s);
+
+        ::std::vector<Index> row_offsets, edge_cols;
+        row_offsets.reserve(a.rows() * b.rows() + 1);
+        edge_cols.reserve(edges);
+        row_offsets.push_back(0);
+        for (auto i{0ULL}; i < a.rows(); i++)
+        {
+            for (auto k{0ULL}; k < b.rows(); k++)
+            {
+                for (auto e{a_offsets[i]}; e < a_offsets[i + 1]; e++)
+                {
+                    auto const base{static_cast<Index>(a_cols[e] * b.cols())};
+                    for (auto f{b_offsets[k]}; f < b_offsets[k + 1]; f++)
+                        edge_cols.push_back(base + b_cols[f]);
+                }
+                row_offsets.push_back(static_cast<Index>(edge_cols.size()));
+            }
+        }
+        return Mod2SparseMatrix(a.rows() * b.rows(), a.cols() * b.cols(), row_offsets, edge_cols);
+    }
+    Mod2SparseMatrix hstack(Mod2SparseMatrix const &a, Mod2SparseMatrix const &b)
+    {
+        if (a.rows() != b.rows())
+            throw ::std::runtime_error("hstack row mismatch."s);
+        auto const a_offsets{a.rowOffsets()}, a_cols{a.edgeCols()};
+        auto const b_offsets{b.rowOffsets()}, b_cols{b.edgeCols()};
+        auto const shift{static_cast<Index>(a.cols())};
+
+        ::std::vector<Index> row_offsets, edge_cols;
+        row_offsets.reserve(a.rows() + 1);
+        edge_cols.reserve(a.edges() + b.edges());
+        row_offsets.push_back(0);
+        for (auto i{0ULL}; i < a.rows(); i++)
+        {
+            edge_cols.insert(edge_cols.end(), a_cols.begin() + a_offsets[i], a_cols.begin() + a_offsets[i + 1]);
+            for (auto f{b_offsets[i]}; f < b_offsets[i + 1]; f++)
+                edge_cols.push_back(shift + b_cols[f]);
+            row_offsets.push_back(static_cast<Index>(edge_cols.size()));
+        }
+        return Mod2SparseMatrix(a.rows(), a.cols() + b.cols(), row_offsets, edge_cols);
+    }
+    Mod2SparseMatrix vstack(Mod2SparseMatrix const &a, Mod2SparseMatrix const &b)
+    {
+        if (a.cols() != b.cols())
+            throw ::std::runtime_error("vstack col mismatch."s);
+        auto const a_offsets{a.rowOffsets()}, a_cols{a.edgeCols()};
+        auto const b_offsets{b.rowOffsets()}, b_cols{b.edgeCols()};
+        auto const shift{static_cast<Index>(a.edges())};
+
+        ::std::vector<Index> row_offsets(a_offsets.begin(), a_offsets.end()), edge_cols(a_cols.begin(), a_cols.end());
+        row_offsets.reserve(a.rows() + b.rows() + 1);
+        for (auto i{1ULL}; i <= b.rows(); i++)
+            row_offsets.push_back(shift + b_offsets[i]);
+        edge_cols.insert(edge_cols.end(), b_cols.begin(), b_cols.end());
+        return Mod2SparseMatrix(a.rows() + b.rows(), a.cols(), row_offsets, edge_cols);
+    }
+    Mod2SparseMatrix identity(size_t size)
+    {
+        ::std::vector<Index> offsets(size + 1);
+        for (auto i{0ULL}; i <= size; i++)
+            offsets[i] = static_cast<Index>(i);
+        return Mod2SparseMatrix(size, size, offsets, {offsets.begin(), offsets.end() - 1});
+    }
+    Mod2SparseMatrix circulant(size_t size, ::std::span<Index const> exponents)
+    {
+        if (size == 0)
+            throw ::std::invalid_argument("Circulant size must be positive."s);
+        // Reduce the polynomial mod (x^size - 1) over GF(2).
+        ::std::vector<Index> terms;
+        for (auto e : exponents)
+            terms.push_back(static_cast<Index>(e % size));
+        ::std::sort(terms.begin(), terms.end());
+        ::std::vector<Index> poly;
+        for (auto t{0ULL}; t < terms.size(); t++)
+        {
+            if (t + 1 < terms.size() && terms[t] == terms[t + 1])
+                t++;
+            else
+                poly.push_back(terms[t]);
+        }
+
+        ::std::vector<Index> row_offsets{0}, edge_cols, row;
+        row_offsets.reserve(size + 1);
+        edge_cols.reserve(size * poly.size());
+        for (auto i{0ULL}; i < size; i++)
+        {
+            row.clear();
+            for (auto e : poly)
+                row.push_back(static_cast<Index>((i + e) % size));
+            ::std::sort(row.begin(), row.end());
+            edge_cols.insert(edge_cols.end(), row.begin(), row.end());
+            row_offsets.push_back(static_cast<Index>(edge_cols.size()));
+        }
+        return Mod2SparseMatrix(size, size, row_offsets, edge_cols);
+    }
+    Mod2SparseMatrix repetitionCode(size_t size, bool cyclic)
+    {
+        if (size < 2)
+            throw ::std::invalid_argument("Repetition code size must be at least 2."s);
+        auto const rows{cyclic ? size : size - 1};
+        ::std::vector<Index> row_offsets{0}, edge_cols;
+        for (auto i{0ULL}; i < rows; i++)
+        {
+            auto const next{static_cast<Index>((i + 1) % size)};
+            // The closing check of the ring touches the last and the first bit; keep the row sorted.
+            edge_cols.push_back(::std::min(static_cast<Index>(i), next));
+            edge_cols.push_back(::std::max(static_cast<Index>(i), next));
+            row_offsets.push_back(static_cast<Index>(edge_cols.size()));
+        }
+        return Mod2SparseMatrix(rows, size, row_offsets, edge_cols);
+    }
+    CssCode hypergraphProduct(Mod2SparseMatrix const &h1, Mod2SparseMatrix const &h2)
+    {
+        auto hx{hstack(kron(h1, identity(h2.cols())), kron(identity(h1.rows()), transpose(h2)))};
+        auto hz{hstack(kron(identity(h1.cols()), h2), kron(transpose(h1), identity(h2.rows())))};
+        return {::std::move(hx), ::std::move(hz)};
+    }
+    CssCode generalizedBicycle(size_t size, ::std::span<Index const> a, ::std::span<Index const> b)
+    {
+        // hx hz^T = A B + B A, which vanishes because circulants of the same size commute.
+        auto const ma{circulant(size, a)}, mb{circulant(size, b)};
+        return {hstack(ma, mb), hstack(transpose(mb), transpose(ma))};
+    }
+    CssCode toricCode(size_t distance)
+    {
+        auto const ring{repetitionCode(distance, true)};
+        return hypergraphProduct(ring, ring);
+    }
+    CssCode surfaceCode(size_t distance)
+    {
+        auto const chain{repetitionCode(distance, false)};
+        return hypergraphProduct(chain, chain);
+    }
+}
@@ -0,0 +1,59 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#pragma once
+
+#ifndef _CODE_CONSTRUCTION_HPP_
+#define _CODE_CONSTRUCTION_HPP_
+
+#include <span>
+#include <cstddef>
+
+#include "sparse_matrix.hpp"
+
+namespace sparse_matrix
+{
+    // Sparse building blocks and parity-check generators that write the CSR arrays of the result directly,
+    // in time linear in the number of edges produced. Entries within each row come out column-ascending
+    // whenever the inputs are.
+
+    // Swap rows and columns; the column view of the input already is the CSR of the transpose.
+    Mod2SparseMatrix transpose(Mod2SparseMatrix const &matrix);
+    // Kronecker product: entry (i * b.rows() + k, j * b.cols() + l) is set iff a(i, j) and b(k, l) are.
+    Mod2SparseMatrix kron(Mod2SparseMatrix const &a, Mod2SparseMatrix const &b);
+    // [a | b] and [a; b]; the shared dimension must match.
+    Mod2SparseMatrix hstack(Mod2SparseMatrix const &a, Mod2SparseMatrix const &b);
+    Mod2SparseMatrix vstack(Mod2SparseMatrix const &a, Mod2SparseMatrix const &b);
+
+    Mod2SparseMatrix identity(size_t size);
+    // The size x size circulant of the polynomial sum of x^e over `exponents`: row i has columns (i + e) mod
+    // size. Exponents equal mod size cancel in pairs.
+    Mod2SparseMatrix circulant(size_t size, ::std::span<Mod2SparseMatrix::Index const> exponents);
+    // Checks x_i + x_{i+1} of the length-`size` repetition code: size - 1 rows, or size rows when `cyclic`
+    // also closes the ring.
+    Mod2SparseMatrix repetitionCode(size_t size, bool cyclic);
+
+    // Check matrices of a CSS code; every row of hx is orthogonal to every row of hz.
+    struct CssCode
+    {
+        Mod2SparseMatrix hx, hz;
+    };
+    // Tillich-Zemor hypergraph product of classical codes h1 (m1 x n1) and h2 (m2 x n2):
+    // hx = [h1 x I(n2) | I(m1) x h2^T], hz = [I(n1) x h2 | h1^T x I(m2)].
+    CssCode hypergraphProduct(Mod2SparseMatrix const &h1, Mod2SparseMatrix const &h2);
+    // Generalized bicycle code from circulants A and B of the given size: hx = [A | B], hz = [B^T | A^T].
+    CssCode generalizedBicycle(size_t size, ::std::span<Mod2SparseMatrix::Index const> a, ::std::span<Mod2SparseMatrix::Index const> b);
+    // Distance-`distance` toric code on 2 * distance^2 qubits, the product of two cyclic repetition codes.
+    CssCode toricCode(size_t distance);
+    // Distance-`distance` planar (unrotated) surface code, the product of two open repetition codes.
+    CssCode surfaceCode(size_t distance);
+}
+
+#endif
@@ -0,0 +1,342 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+// Loading detector error models. See https://github.com/quantumlib/Stim/blob/main/doc/file_format_dem_detector_error_model.md
+#include "dem_file.hpp"
+#include "mapped_file.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <algorithm>
+#include <bit>
+
+namespace sparse_matrix
+{
+    namespace
+    {
+        using Index = Mod2SparseMatrix::Index;
+
+        // Collects the mechanisms as columns, merging duplicates on the fly.
+        class DemBuilder
+        {
+        private: // consts
+            // Observables are stored among the targets with this bit set, so they sort after the detectors.
+            static constexpr uint64_t observable_bit{uint64_t{1} << 63};
+            static constexpr Index empty_slot{UINT32_MAX};
+
+        private: // members
+            ::std::vector<uint64_t> targets; // sorted targets of every column, back to back
+            ::std::vector<size_t> target_offsets;
+            ::std::vector<double> priors;
+            // Open-addressing table of columns by target-list hash, linear probing, at most half full. Every slot
+            // keeps the high half of its hash, so probing past other lists rarely touches their targets.
+            struct Slot
+            {
+                uint32_t tag;
+                Index col;
+            };
+            ::std::vector<Slot> slots;
+            ::std::vector<uint64_t> hashes; // hash of every column, for rehashing
+            uint64_t detector_count, observable_count;
+
+        private: // workspace
+            ::std::vector<uint64_t> key;
+
+        private: // utils
+            static uint64_t hash(::std::span<uint64_t const> words)
+            {
+                uint64_t hash{0xcbf29ce484222325ULL};
+                for (auto word : words)
+                    hash = (hash ^ word) * 0x100000001b3ULL;
+                // Multiplication only carries upward; fold the high bits into the low ones the table masks.
+                hash ^= hash >> 33;
+                hash *= 0xff51afd7ed558ccdULL;
+                return hash ^ (hash >> 33);
+            }
+            ::std::span<uint64_t const> column(Index col) const
+            {
+                return {this->targets.data() + this->target_offsets[col], this->target_offsets[col + 1] - this->target_offsets[col]};
+            }
+            void rehash(size_t size)
+            {
+                this->slots.assign(size, {0, empty_slot});
+                auto const mask{size - 1};
+                for (Index j{0}; j < this->hashes.size(); j++)
+                {
+                    auto s{this->hashes[j] & mask};
+                    while (this->slots[s].col != empty_slot)
+                        s = (s + 1) & mask;
+                    this->slots[s] = {static_cast<uint32_t>(this->hashes[j] >> 32), j};
+                }
+            }
+            // The targets whose observable bit equals `kind` as a rows x mechanisms matrix.
+            Mod2SparseMatrix matrix(size_t rows, uint64_t kind) const
+            {
+                auto const cols{this->priors.size()};
+                ::std::vector<Index> row_offsets(rows + 1, 0), edge_cols;
+                for (auto t : this->targets)
+                    if ((t & observable_bit) == kind)
+                        row_offsets[(t & ~observable_bit) + 1]++;
+                for (auto i{0ULL}; i < rows; i++)
+                    row_offsets[i + 1] += row_offsets[i];
+                edge_cols.resize(row_offsets.back());
+                ::std::vector<Index> fill(row_offsets.begin(), row_offsets.end() - 1);
+                // Columns are visited in order, so every row lists its columns ascending.
+                for (Index j{0}; j < cols; j++)
+                    for (auto t : this->column(j))
+                        if ((t & observable_bit) == kind)
+                            edge_cols[fill[t & ~observable_bit]++] = j;
+                return Mod2SparseMatrix(rows, cols, row_offsets, edge_cols);
+            }
+
+        public: // apis
+            explicit DemBuilder(size_t expected) : target_offsets{0}, detector_count{0}, observable_count{0}
+            {
+                this->rehash(::std::bit_ceil(::std::max<size_t>(expected * 2, 16)));
+            }
+            void declareDetector(uint64_t id) { this->detector_count = ::std::max(this->detector_count, id + 1); }
+            void declareObservable(uint64_t id) { this->observable_count = ::std::max(this->observable_count, id + 1); }
+            // Targets of one mechanism are added between beginMechanism() and addMechanism().
+            void beginMechanism() { this->key.clear(); }
+            void addDetectorTarget(uint64_t id) { this->key.push_back(id); }
+            void addObservableTarget(uint64_t id) { this->key.push_back(id | observable_bit); }
+            void addMechanism(double probability)
+            {
+                auto &key{this->key};
+                // A target listed twice is flipped twice.
+                ::std::sort(key.begin(), key.end());
+                size_t size{0};
+                for (auto k{0ULL}; k < key.size(); k++)
+                {
+                    if (k + 1 < key.size() && key[k] == key[k + 1])
+                        k++;
+                    else
+                        key[size++] = key[k];
+                }
+                key.resize(size);
+                for (auto t : key)
+                    (t & observable_bit) ? this->declareObservable(t & ~observable_bit) : this->declareDetector(t);
+                if (key.empty() || probability == 0)
+                    return;
+
+                auto const h{hash(key)};
+                auto const mask{this->slots.size() - 1};
+                auto const tag{static_cast<uint32_t>(h >> 32)};
+                auto s{h & mask};
+                for (; this->slots[s].col != empty_slot; s = (s + 1) & mask)
+                {
+                    if (this->slots[s].tag != tag)
+                        continue;
+                    auto const j{this->slots[s].col};
+                    auto const existing{this->column(j)};
+                    if (::std::equal(existing.begin(), existing.end(), key.begin(), key.end()))
+                    {
+                        // Two independent mechanisms with the same effect: it shows when exactly one fires.
+                        auto &prior{this->priors[j]};
+                        prior = prior * (1 - probability) + probability * (1 - prior);
+                        return;
+                    }
+                }
+                if (this->priors.size() >= UINT32_MAX - 1)
+                    throw ::std::runtime_error("Detector error model too large for 32-bit index."s);
+                this->slots[s] = {tag, static_cast<Index>(this->priors.size())};
+                this->hashes.push_back(h);
+                this->targets.insert(this->targets.end(), key.begin(), key.end());
+                this->target_offsets.push_back(this->targets.size());
+                this->priors.push_back(probability);
+                if (this->priors.size() * 2 > this->slots.size())
+                    this->rehash(this->slots.size() * 2);
+            }
+            DetectorErrorModel build() &&
+            {
+                if (this->priors.size() > UINT32_MAX || this->detector_count > UINT32_MAX)
+                    throw ::std::runtime_error("Detector error model too large for 32-bit index."s);
+                DetectorErrorModel model;
+                model.check_matrix = this->matrix(this->detector_count, 0);
+                model.observables = this->matrix(this->observable_count, observable_bit);
+                model.priors = ::std::move(this->priors);
+                return model;
+            }
+        };
+
+        // Line-oriented reader of one block of instructions.
+        class DemReader
+        {
+        private: // members
+            DemBuilder &builder;
+
+        private: // utils
+            [[noreturn]] static void fail(::std::string_view reason, ::std::string_view line)
+            {
+                throw ::std::runtime_error("Invalid dem file: "s + ::std::string{reason} + ": "s + ::std::string{line});
+            }
+            static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+            // The line without its comment and surrounding blanks.
+            static ::std::string_view trim(::std::string_view line)
+            {
+                line = line.substr(0, line.find('#'));
+                while (!line.empty() && isSpace(line.front()))
+                    line.remove_prefix(1);
+                while (!line.empty() && isSpace(line.back()))
+                    line.remove_suffix(1);
+                return line;
+            }
+            static ::std::string_view nextLine(::std::string_view &text)
+            {
+                auto const end{text.find('\n')};
+                auto const line{text.substr(0, end)};
+                text.remove_prefix(end == ::std::string_view::npos ? text.size() : end + 1);
+                return line;
+            }
+            static ::std::string_view nextToken(::std::string_view &rest)
+            {
+                while (!rest.empty() && isSpace(rest.front()))
+                    rest.remove_prefix(1);
+                auto size{0ULL};
+                while (size < rest.size() && !isSpace(rest[size]))
+                    size++;
+                auto const token{rest.substr(0, size)};
+                rest.remove_prefix(size);
+                return token;
+            }
+            template <typename T>
+            static T number(::std::string_view token, ::std::string_view line)
+            {
+                T value{};
+                auto const [end, error]{::std::from_chars(token.data(), token.data() + token.size(), value)};
+                if (error != ::std::errc{} || end != token.data() + token.size())
+                    fail("invalid number"sv, line);
+                return value;
+            }
+            // Id of a `D<k>` or `L<k>` target.
+            static uint64_t targetId(::std::string_view token, ::std::string_view line)
+            {
+                auto const id{number<uint64_t>(token.substr(1), line)};
+                if (id >= UINT32_MAX)
+                    fail("target id out of range"sv, line);
+                return id;
+            }
+            // Split off the body of the repeat block whose header was just read, up to its closing brace.
+            static ::std::string_view blockBody(::std::string_view &text, ::std::string_view header)
+            {
+                auto const *const begin{text.data()};
+                for (size_t depth{1}; !text.empty();)
+                {
+                    auto const *const line_begin{text.data()};
+                    auto const line{trim(nextLine(text))};
+                    if (line == "}"sv && --depth == 0)
+                        return {begin, static_cast<size_t>(line_begin - begin)};
+                    if (!line.empty() && line.back() == '{')
+                        depth++;
+                }
+                fail("unterminated repeat block"sv, header);
+            }
+
+        public: // apis
+            explicit DemReader(DemBuilder &builder) : builder{builder} {}
+            void read(::std::string_view text, uint64_t &detector_offset)
+            {
+                while (!text.empty())
+                {
+                    auto const line{trim(nextLine(text))};
+                    if (line.empty())
+                        continue;
+                    // name[tag](args) targets...
+                    auto size{0ULL};
+                    while (size < line.size() && (::std::isalnum(static_cast<unsigned char>(line[size])) || line[size] == '_'))
+                        size++;
+                    auto const name{line.substr(0, size)};
+                    auto rest{line.substr(size)};
+                    if (!rest.empty() && rest.front() == '[')
+                    {
+                        auto const close{rest.find(']')};
+                        if (close == ::std::string_view::npos)
+                            fail("unterminated tag"sv, line);
+                        rest.remove_prefix(close + 1);
+                    }
+                    ::std::string_view args;
+                    if (!rest.empty() && rest.front() == '(')
+                    {
+                        auto const close{rest.find(')')};
+                        if (close == ::std::string_view::npos)
+                            fail("unterminated arguments"sv, line);
+                        args = rest.substr(1, close - 1);
+                        rest.remove_prefix(close + 1);
+                    }
+
+                    if (name == "error"sv)
+                    {
+                        auto const probability{number<double>(trim(args), line)};
+                        if (!(probability >= 0 && probability <= 1))
+                            fail("probability out of [0, 1]"sv, line);
+                        this->builder.beginMechanism();
+                        for (auto token{nextToken(rest)}; !token.empty(); token = nextToken(rest))
+                        {
+                            if (token[0] == 'D')
+                                this->builder.addDetectorTarget(detector_offset + targetId(token, line));
+                            else if (token[0] == 'L')
+                                this->builder.addObservableTarget(targetId(token, line));
+                            else if (token != "^"sv)
+                                fail("invalid error target"sv, line);
+                        }
+                        this->builder.addMechanism(probability);
+                    }
+                    else if (name == "detector"sv)
+                    {
+                        for (auto token{nextToken(rest)}; !token.empty(); token = nextToken(rest))
+                        {
+                            if (token[0] != 'D')
+                                fail("invalid detector target"sv, line);
+                            this->builder.declareDetector(detector_offset + targetId(token, line));
+                        }
+                    }
+                    else if (name == "logical_observable"sv)
+                    {
+                        for (auto token{nextToken(rest)}; !token.empty(); token = nextToken(rest))
+                        {
+                            if (token[0] != 'L')
+                                fail("invalid observable target"sv, line);
+                            this->builder.declareObservable(targetId(token, line));
+                        }
+                    }
+                    else if (name == "detector_separator"sv)
+                        continue; // only groups detectors for display, like detector coordinates
+                    else if (name == "shift_detectors"sv)
+                        detector_offset += number<uint64_t>(nextToken(rest), line);
+                    else if (name == "repeat"sv)
+                    {
+                        auto const count{number<uint64_t>(nextToken(rest), line)};
+                        if (nextToken(rest) != "{"sv)
+                            fail("repeat without block"sv, line);
+                        auto const body{blockBody(text, line)};
+                        for (auto r{0ULL}; r < count; r++)
+                            this->read(body, detector_offset);
+                    }
+                    else
+                        fail("unknown instruction"sv, line);
+                }
+            }
+        };
+    }
+
+    DetectorErrorModel DetectorErrorModel::parse(::std::string_view text)
+    {
+        // Roughly one mechanism per 24 bytes in typical circuit-level models.
+        DemBuilder builder{text.size() / 24};
+        uint64_t detector_offset{0};
+        DemReader{builder}.read(text, detector_offset);
+        return ::std::move(builder).build();
+    }
+    DetectorErrorModel DetectorErrorModel::fromFile(::std::string const &path)
+    {
+        MappedFile file{path};
+        return parse({file.data(), file.size()});
+    }
+}
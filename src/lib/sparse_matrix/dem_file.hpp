@@ -0,0 +1,41 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#pragma once
+
+#ifndef _DEM_FILE_HPP_
+#define _DEM_FILE_HPP_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sparse_matrix.hpp"
+
+namespace sparse_matrix
+{
+    // A Stim detector error model flattened into decoder inputs: every distinct error mechanism is one column.
+    // Supported: error, detector, logical_observable, shift_detectors and nested repeat blocks. Instruction
+    // tags, coordinates and detector_separator lines are skipped, and `^` separators are ignored, so a
+    // decomposed error flips the sum of its parts. Mechanisms with the same detectors and observables are merged into one column whose
+    // probability is that an odd number of them fire; mechanisms that flip nothing are dropped.
+    struct DetectorErrorModel
+    {
+        Mod2SparseMatrix check_matrix; // detectors x mechanisms
+        Mod2SparseMatrix observables;  // observables x mechanisms
+        ::std::vector<double> priors;  // probability of every mechanism
+
+        // Parse in one pass over the text; repeat blocks are replayed from their body without copying it.
+        static DetectorErrorModel parse(::std::string_view text);
+        static DetectorErrorModel fromFile(::std::string const &path);
+    };
+}
+
+#endif
@@ -0,0 +1,238 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+// Loading Mod2SparseMatrix from alist text and from compiled graph files.
+#include "sparse_matrix.hpp"
+#include "mapped_file.hpp"
+
+#include <bit>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <utility>
+
+namespace sparse_matrix
+{
+    namespace
+    {
+        // Tokenizer for the unsigned integers of an alist file.
+        class AlistReader
+        {
+        private: // members
+            char const *pos, *end;
+
+        public: // apis
+            explicit AlistReader(::std::string_view text) : pos{text.data()}, end{text.data() + text.size()} {}
+            size_t next()
+            {
+                while (this->pos != this->end && static_cast<unsigned char>(*this->pos) <= ' ')
+                    this->pos++;
+                if (this->pos == this->end)
+                    throw ::std::runtime_error("Unexpected EOF in alist file."s);
+                if (*this->pos < '0' || *this->pos > '9')
+                    throw ::std::runtime_error("Invalid token in alist file."s);
+                size_t value{0};
+                for (; this->pos != this->end && *this->pos >= '0' && *this->pos <= '9'; this->pos++)
+                    value = value * 10 + static_cast<size_t>(*this->pos - '0');
+                return value;
+            }
+        };
+
+        struct GraphFileHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t index_bytes;
+            uint64_t rows, cols, edges;
+            uint64_t checksum; // of the array block
+            uint64_t source;   // fingerprint passed to save(), 0 if none
+            uint64_t reserved;
+        };
+        static_assert(sizeof(GraphFileHeader) == 64);
+        constexpr char graph_file_magic[8]{'B', 'P', 'G', 'R', 'A', 'P', 'H', '\0'};
+        constexpr uint32_t graph_file_version{1};
+
+        // FNV-1a folded over 64-bit words, then over the trailing bytes.
+        uint64_t checksum(char const *data, size_t size)
+        {
+            uint64_t hash{0xcbf29ce484222325ULL};
+            constexpr uint64_t prime{0x100000001b3ULL};
+            auto i{0ULL};
+            for (; i + 8 <= size; i += 8)
+            {
+                uint64_t word;
+                ::std::memcpy(&word, data + i, 8);
+                hash = (hash ^ word) * prime;
+            }
+            for (; i < size; i++)
+                hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+            return hash;
+        }
+        // Copy out and check the fixed part of the header; the sizes are checked by load().
+        GraphFileHeader readHeader(MappedFile const &file)
+        {
+            if constexpr (::std::endian::native != ::std::endian::little)
+                throw ::std::runtime_error("Compiled graph files require a little-endian host."s);
+            GraphFileHeader header;
+            if (file.size() < sizeof(header))
+                throw ::std::runtime_error("Truncated compiled graph file."s);
+            ::std::memcpy(&header, file.data(), sizeof(header));
+            if (::std::memcmp(header.magic, graph_file_magic, sizeof(header.magic)) != 0)
+                throw ::std::runtime_error("Not a compiled graph file."s);
+            if (header.version != graph_file_version || header.index_bytes != sizeof(Mod2SparseMatrix::Index))
+                throw ::std::runtime_error("Unsupported compiled graph file version."s);
+            return header;
+        }
+    }
+
+    Mod2SparseMatrix Mod2SparseMatrix::parseAlist(::std::string_view text)
+    {
+        AlistReader reader{text};
+        auto const row{reader.next()}, col{reader.next()};
+        auto const max_weight_forall_rows{reader.next()}, max_weight_forall_cols{reader.next()};
+        if (max_weight_forall_rows > col || max_weight_forall_cols > row)
+            throw ::std::runtime_error("Unexpected EOF or invalid max_weight."s);
+
+        ::std::vector<Index> row_offsets(row + 1, 0), weights_each_col(col);
+        for (auto i{0ULL}; i < row; i++)
+        {
+            auto const row_weight{reader.next()};
+            if (row_weight > max_weight_forall_rows)
+                throw ::std::runtime_error("Unexpected EOF or invalid row weight."s);
+            row_offsets[i + 1] = static_cast<Index>(row_offsets[i] + row_weight);
+        }
+        for (auto &col_weight : weights_each_col)
+        {
+            col_weight = static_cast<Index>(reader.next());
+            if (col_weight > max_weight_forall_cols)
+                throw ::std::runtime_error("Unexpected EOF or invalid col weight."s);
+        }
+        ::std::vector<Index> edge_cols(row_offsets.back()), col_offsets(col + 1, 0);
+        for (auto &index : edge_cols)
+        {
+            index = static_cast<Index>(reader.next() - 1); // start from 1
+            if (index >= col)
+                throw ::std::runtime_error("Unexpected EOF or invalid index."s);
+            col_offsets[index + 1]++;
+        }
+        for (auto j{0ULL}; j < col; j++)
+        {
+            if (col_offsets[j + 1] != weights_each_col[j])
+                throw ::std::runtime_error("Column weights do not match row lists."s);
+            col_offsets[j + 1] += col_offsets[j];
+        }
+        // The column lists are redundant: check that they describe the same edges as the row lists, then drop
+        // them. Rows are visited in order, so every expected column comes out row-ascending.
+        ::std::vector<Index> col_rows(edge_cols.size()), fill(col_offsets.begin(), col_offsets.end() - 1);
+        for (auto i{0ULL}; i < row; i++)
+            for (auto e{row_offsets[i]}; e < row_offsets[i + 1]; e++)
+                col_rows[fill[edge_cols[e]]++] = static_cast<Index>(i);
+        ::std::vector<Index> listed;
+        for (auto j{0ULL}; j < col; j++)
+        {
+            listed.clear();
+            for (auto k{col_offsets[j]}; k < col_offsets[j + 1]; k++)
+            {
+                auto const index{reader.next() - 1};
+                if (index >= row)
+                    throw ::std::runtime_error("Unexpected EOF or invalid index."s);
+                listed.push_back(static_cast<Index>(index));
+            }
+            ::std::sort(listed.begin(), listed.end());
+            if (!::std::equal(listed.begin(), listed.end(), col_rows.begin() + col_offsets[j]))
+                throw ::std::runtime_error("Column lists do not match row lists."s);
+        }
+        return Mod2SparseMatrix(row, col, row_offsets, edge_cols);
+    }
+    Mod2SparseMatrix Mod2SparseMatrix::fromAlist(::std::string const &path)
+    {
+        MappedFile file{path};
+        return parseAlist({file.data(), file.size()});
+    }
+    uint64_t Mod2SparseMatrix::fingerprint(::std::string_view bytes)
+    {
+        return checksum(bytes.data(), bytes.size());
+    }
+    void Mod2SparseMatrix::save(::std::string const &path, uint64_t source) const
+    {
+        if constexpr (::std::endian::native != ::std::endian::little)
+            throw ::std::runtime_error("Compiled graph files require a little-endian host."s);
+        if (!this->storage)
+            throw ::std::runtime_error("Cannot save an empty matrix."s);
+        auto const *block{reinterpret_cast<char const *>(this->row_offsets.data())};
+        auto const block_size{blockLength(this->row, this->col, this->nnz) * sizeof(Index)};
+
+        GraphFileHeader header{};
+        ::std::memcpy(header.magic, graph_file_magic, sizeof(header.magic));
+        header.version = graph_file_version;
+        header.index_bytes = sizeof(Index);
+        header.rows = this->row;
+        header.cols = this->col;
+        header.edges = this->nnz;
+        header.checksum = checksum(block, block_size);
+        header.source = source;
+
+        ::std::ofstream stream{path, ::std::ios::binary};
+        if (!stream)
+            throw ::std::runtime_error("Could not create file: "s + path);
+        stream.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        stream.write(block, static_cast<::std::streamsize>(block_size));
+        if (!stream)
+            throw ::std::runtime_error("Could not write file: "s + path);
+    }
+    Mod2SparseMatrix Mod2SparseMatrix::load(::std::string const &path)
+    {
+        auto file{::std::make_shared<MappedFile>(path)};
+        auto const header{readHeader(*file)};
+        if (header.rows > UINT32_MAX || header.cols > UINT32_MAX || header.edges > UINT32_MAX)
+            throw ::std::runtime_error("Invalid compiled graph dimensions."s);
+        auto const block_size{blockLength(header.rows, header.cols, header.edges) * sizeof(Index)};
+        if (file->size() != sizeof(header) + block_size)
+            throw ::std::runtime_error("Truncated compiled graph file."s);
+        auto const *block{file->data() + sizeof(header)};
+        if (checksum(block, block_size) != header.checksum)
+            throw ::std::runtime_error("Compiled graph checksum mismatch."s);
+
+        Mod2SparseMatrix matrix;
+        matrix.row = header.rows;
+        matrix.col = header.cols;
+        matrix.nnz = header.edges;
+        matrix.bind(file, reinterpret_cast<Index const *>(block));
+        // The checksum only catches accidental damage; validate the arrays once so that no index read from the
+        // file can take a later access out of bounds.
+        auto const monotonic = [](::std::span<Index const> offsets, size_t nnz)
+        {
+            return offsets.front() == 0 && offsets.back() == nnz && ::std::is_sorted(offsets.begin(), offsets.end());
+        };
+        if (!monotonic(matrix.row_offsets, matrix.nnz) || !monotonic(matrix.col_offsets, matrix.nnz))
+            throw ::std::runtime_error("Corrupted compiled graph offsets."s);
+        for (auto e : matrix.edge_cols)
+            if (e >= matrix.col)
+                throw ::std::runtime_error("Corrupted compiled graph indices."s);
+        // The column view must list every edge id exactly once: there are nnz slots, so it suffices that no id
+        // repeats.
+        ::std::vector<uint8_t> seen(matrix.nnz, 0);
+        for (auto j{0ULL}; j < matrix.col; j++)
+        {
+            for (auto k{matrix.col_offsets[j]}; k < matrix.col_offsets[j + 1]; k++)
+            {
+                auto const e{matrix.col_edges[k]}, i{matrix.col_rows[k]};
+                if (e >= matrix.nnz || i >= matrix.row || matrix.edge_cols[e] != j ||
+                    e < matrix.row_offsets[i] || e >= matrix.row_offsets[i + 1] || ::std::exchange(seen[e], 1))
+                    throw ::std::runtime_error("Corrupted compiled graph indices."s);
+            }
+        }
+        return matrix;
+    }
+    uint64_t Mod2SparseMatrix::sourceOf(::std::string const &path)
+    {
+        return readHeader(MappedFile{path}).source;
+    }
+}
@@ -0,0 +1,93 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+// Internal to the SparseMatrix library: shared by the alist, graph file and detector error model loaders.
+#pragma once
+
+#ifndef _MAPPED_FILE_HPP_
+#define _MAPPED_FILE_HPP_
+
+#include <string>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <vector>
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using ::std::operator""s;
+
+namespace sparse_matrix
+{
+    // Read-only view of a whole file, memory-mapped where the platform allows it.
+    class MappedFile
+    {
+    private: // members
+        char const *bytes;
+        size_t length;
+#if defined(_WIN32)
+        ::std::vector<char> buffer;
+#endif
+
+    public: // apis
+        explicit MappedFile(::std::string const &path) : bytes{nullptr}, length{0}
+        {
+#if defined(_WIN32)
+            ::std::ifstream stream{path, ::std::ios::binary};
+            if (!stream)
+                throw ::std::runtime_error("Could not open file: "s + path);
+            this->buffer.assign(::std::istreambuf_iterator<char>{stream}, ::std::istreambuf_iterator<char>{});
+            this->bytes = this->buffer.data();
+            this->length = this->buffer.size();
+#else
+            auto fd{::open(path.c_str(), O_RDONLY)};
+            if (fd < 0)
+                throw ::std::runtime_error("Could not open file: "s + path);
+            struct ::stat status;
+            if (::fstat(fd, &status) != 0)
+            {
+                ::close(fd);
+                throw ::std::runtime_error("Could not stat file: "s + path);
+            }
+            this->length = static_cast<size_t>(status.st_size);
+            if (this->length)
+            {
+                auto *address{::mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0)};
+                if (address == MAP_FAILED)
+                {
+                    ::close(fd);
+                    throw ::std::runtime_error("Could not map file: "s + path);
+                }
+                this->bytes = static_cast<char const *>(address);
+            }
+            ::close(fd);
+#endif
+        }
+        MappedFile(MappedFile const &) = delete;
+        MappedFile &operator=(MappedFile const &) = delete;
+        ~MappedFile()
+        {
+#if !defined(_WIN32)
+            if (this->bytes)
+                ::munmap(const_cast<char *>(this->bytes), this->length);
+#endif
+        }
+        char const *data() const { return this->bytes; }
+        size_t size() const { return this->length; }
+    };
+}
+
+#endif
@@ -0,0 +1,80 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#include "mod2_vector.hpp"
+
+#include <bit>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+using ::std::operator""s;
+
+namespace sparse_matrix
+{
+    Mod2Vector Mod2Vector::fromBytes(::std::span<uint8_t const> bytes)
+    {
+        Mod2Vector vec(bytes.size());
+        vec.assign(bytes);
+        return vec;
+    }
+    void Mod2Vector::assign(::std::span<uint8_t const> bytes)
+    {
+        if (bytes.size() != this->length)
+            throw ::std::runtime_error("Byte buffer length mismatch vector size."s);
+        for (auto w{0ULL}; w < this->data.size(); w++)
+        {
+            uint64_t word{0};
+            for (size_t b{0}, base{w * 64}, n{::std::min<size_t>(64, this->length - base)}; b < n; b++)
+                word |= static_cast<uint64_t>(bytes[base + b] != 0) << b;
+            this->data[w] = word;
+        }
+    }
+    void Mod2Vector::toBytes(::std::span<uint8_t> bytes) const
+    {
+        if (bytes.size() != this->length)
+            throw ::std::runtime_error("Byte buffer length mismatch vector size."s);
+        for (auto i{0ULL}; i < this->length; i++)
+            bytes[i] = this->data[i / 64] >> (i % 64) & 1;
+    }
+    void Mod2Vector::clear()
+    {
+        ::std::fill(this->data.begin(), this->data.end(), 0);
+    }
+    bool Mod2Vector::any() const
+    {
+        return ::std::any_of(this->data.begin(), this->data.end(), [](uint64_t word)
+                             { return word != 0; });
+    }
+    size_t Mod2Vector::weight() const
+    {
+        size_t result{0};
+        for (auto word : this->data)
+            result += ::std::popcount(word);
+        return result;
+    }
+    Mod2Vector &Mod2Vector::operator^=(Mod2Vector const &that)
+    {
+        if (this->length != that.length)
+            throw ::std::runtime_error("Vector size mismatch."s);
+        for (auto w{0ULL}; w < this->data.size(); w++)
+            this->data[w] ^= that.data[w];
+        return *this;
+    }
+    size_t hammingDistance(Mod2Vector const &a, Mod2Vector const &b)
+    {
+        if (a.length != b.length)
+            throw ::std::runtime_error("Vector size mismatch."s);
+        size_t result{0};
+        for (auto w{0ULL}; w < a.data.size(); w++)
+            result += ::std::popcount(a.data[w] ^ b.data[w]);
+        return result;
+    }
+}
@@ -0,0 +1,65 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+#pragma once
+
+#ifndef _MOD2_VECTOR_HPP_
+#define _MOD2_VECTOR_HPP_
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+namespace sparse_matrix
+{
+    // Bit-packed GF(2) vector: bit i is bit (i % 64) of word i / 64. Bits past size() are always zero.
+    class Mod2Vector
+    {
+    private: // members
+        size_t length;
+        ::std::vector<uint64_t> data;
+
+    public: // apis
+        static constexpr size_t wordsFor(size_t length) { return (length + 63) / 64; }
+
+        explicit Mod2Vector(size_t length = 0) : length{length}, data(wordsFor(length), 0) {}
+        // Pack one byte per bit (any nonzero byte is a 1).
+        static Mod2Vector fromBytes(::std::span<uint8_t const> bytes);
+        // Repack in place from one byte per bit; `bytes` must have size() entries.
+        void assign(::std::span<uint8_t const> bytes);
+        // Unpack into one byte per bit; `bytes` must have size() entries.
+        void toBytes(::std::span<uint8_t> bytes) const;
+
+        size_t size() const { return this->length; }
+        ::std::span<uint64_t const> words() const { return this->data; }
+        ::std::span<uint64_t> words() { return this->data; }
+
+        bool get(size_t i) const { return this->data[i / 64] >> (i % 64) & 1; }
+        void set(size_t i, bool bit)
+        {
+            auto const mask{uint64_t{1} << (i % 64)};
+            this->data[i / 64] = bit ? this->data[i / 64] | mask : this->data[i / 64] & ~mask;
+        }
+        void flip(size_t i) { this->data[i / 64] ^= uint64_t{1} << (i % 64); }
+        void clear();
+
+        bool any() const;
+        // Number of ones.
+        size_t weight() const;
+        Mod2Vector &operator^=(Mod2Vector const &that);
+        bool operator==(Mod2Vector const &that) const = default;
+
+        // Number of positions where the two vectors differ.
+        friend size_t hammingDistance(Mod2Vector const &a, Mod2Vector const &b);
+    };
+}
+
+#endif
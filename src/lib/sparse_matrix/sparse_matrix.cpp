@@ -10,17 +10,138 @@
  */
 #include "sparse_matrix.hpp"
 
+#include <bit>
+#include <iterator>
+
 namespace sparse_matrix
 {
+    Mod2SparseMatrix::Mod2SparseMatrix(size_t row, size_t col, ::std::vector<Index> const &row_offsets, ::std::vector<Index> const &edge_cols)
+        : row{row}, col{col}, nnz{edge_cols.size()}
+    {
+        if (row_offsets.size() != row + 1 || row_offsets.front() != 0 || row_offsets.back() != this->nnz)
+            throw ::std::runtime_error("Invalid CSR row offsets."s);
+        if (this->nnz > UINT32_MAX || row > UINT32_MAX || col > UINT32_MAX)
+            throw ::std::runtime_error("Matrix too large for 32-bit edge index."s);
+
+        auto block{::std::make_shared<::std::vector<Index>>(blockLength(row, col, this->nnz))};
+        auto *base{block->data()};
+        auto *r_off{base}, *e_col{r_off + row + 1}, *c_off{e_col + this->nnz}, *c_edge{c_off + col + 1}, *c_row{c_edge + this->nnz};
+
+        ::std::copy(row_offsets.begin(), row_offsets.end(), r_off);
+        ::std::copy(edge_cols.begin(), edge_cols.end(), e_col);
+        // Counting sort of the edges by column; rows are visited in order so every column stays row-ascending.
+        for (auto e{0ULL}; e < this->nnz; e++)
+        {
+            if (e_col[e] >= col)
+                throw ::std::runtime_error("Column index out of range."s);
+            c_off[e_col[e] + 1]++;
+        }
+        for (auto j{0ULL}; j < col; j++)
+            c_off[j + 1] += c_off[j];
+        ::std::vector<Index> fill(c_off, c_off + col);
+        for (auto i{0ULL}; i < row; i++)
+        {
+            if (r_off[i] > r_off[i + 1])
+                throw ::std::runtime_error("Invalid CSR row offsets."s);
+            for (auto e{r_off[i]}; e < r_off[i + 1]; e++)
+            {
+                auto pos{fill[e_col[e]]++};
+                c_edge[pos] = e;
+                c_row[pos] = static_cast<Index>(i);
+            }
+        }
+
+        this->bind(::std::move(block), base);
+    }
+    void Mod2SparseMatrix::bind(::std::shared_ptr<void const> storage, Index const *block)
+    {
+        this->row_offsets = {block, this->row + 1};
+        this->edge_cols = {this->row_offsets.data() + this->row_offsets.size(), this->nnz};
+        this->col_offsets = {this->edge_cols.data() + this->nnz, this->col + 1};
+        this->col_edges = {this->col_offsets.data() + this->col_offsets.size(), this->nnz};
+        this->col_rows = {this->col_edges.data() + this->nnz, this->nnz};
+        this->storage = ::std::move(storage);
+    }
     ::std::vector<uint8_t> Mod2SparseMatrix::operator*(::std::vector<uint8_t> const &vec) const
+    {
+        ::std::vector<uint8_t> result(this->row);
+        this->multiply(vec, result);
+        return result;
+    }
+    void Mod2SparseMatrix::multiply(::std::span<uint8_t const> vec, ::std::span<uint8_t> result) const
     {
         if (this->col != vec.size())
             throw ::std::runtime_error("Vec length mismatch matrix col."s);
-        ::std::vector<uint8_t> result(this->row, 0);
-        for (auto j{0}; j < this->col; j++)
+        if (this->row != result.size())
+            throw ::std::runtime_error("Result length mismatch matrix row."s);
+        ::std::fill(result.begin(), result.end(), 0);
+        for (auto j{0ULL}; j < this->col; j++)
             if (vec[j])
-                for (auto const &item : this->items_each_col[j])
-                    result[item->row_index] ^= 1;
+                for (auto k{this->col_offsets[j]}; k < this->col_offsets[j + 1]; k++)
+                    result[this->col_rows[k]] ^= 1;
+    }
+    Mod2Vector Mod2SparseMatrix::operator*(Mod2Vector const &vec) const
+    {
+        Mod2Vector result(this->row);
+        this->multiply(vec, result);
         return result;
     }
+    void Mod2SparseMatrix::multiply(Mod2Vector const &vec, Mod2Vector &result) const
+    {
+        if (this->col != vec.size())
+            throw ::std::runtime_error("Vec length mismatch matrix col."s);
+        if (this->row != result.size())
+            throw ::std::runtime_error("Result length mismatch matrix row."s);
+        result.clear();
+        auto const words{vec.words()};
+        for (auto w{0ULL}; w < words.size(); w++)
+        {
+            for (auto word{words[w]}; word; word &= word - 1)
+            {
+                auto const j{w * 64 + ::std::countr_zero(word)};
+                for (auto k{this->col_offsets[j]}; k < this->col_offsets[j + 1]; k++)
+                    result.flip(this->col_rows[k]);
+            }
+        }
+    }
+    ::std::istream &operator>>(::std::istream &stream, Mod2SparseMatrix &me)
+    {
+        if (!stream)
+            throw ::std::runtime_error("Could not open alist file."s);
+        ::std::string text{::std::istreambuf_iterator<char>{stream}, ::std::istreambuf_iterator<char>{}};
+        me = Mod2SparseMatrix::parseAlist(text);
+        return stream;
+    }
+    ::std::ostream &operator<<(::std::ostream &stream, Mod2SparseMatrix const &me)
+    {
+        ::std::vector<size_t> weights_each_row, weights_each_col;
+        for (auto i{0ULL}; i < me.row; i++)
+            weights_each_row.push_back(me.row_offsets[i + 1] - me.row_offsets[i]);
+        for (auto j{0ULL}; j < me.col; j++)
+            weights_each_col.push_back(me.col_offsets[j + 1] - me.col_offsets[j]);
+        auto max_weight_forall_rows = weights_each_row.empty() ? 0 : *::std::max_element(weights_each_row.begin(), weights_each_row.end()),
+             max_weight_forall_cols = weights_each_col.empty() ? 0 : *::std::max_element(weights_each_col.begin(), weights_each_col.end());
+
+        stream << me.row << ' ' << me.col << '\n'
+               << max_weight_forall_rows << ' ' << max_weight_forall_cols << '\n';
+        for (auto row_weight : weights_each_row)
+            stream << row_weight << ' ';
+        stream << '\n';
+        for (auto col_weight : weights_each_col)
+            stream << col_weight << ' ';
+        stream << '\n';
+        for (auto i{0ULL}; i < me.row; i++)
+        {
+            for (auto e{me.row_offsets[i]}; e < me.row_offsets[i + 1]; e++)
+                stream << (me.edge_cols[e] + 1) << ' ';
+            stream << '\n';
+        }
+        for (auto j{0ULL}; j < me.col; j++)
+        {
+            for (auto k{me.col_offsets[j]}; k < me.col_offsets[j + 1]; k++)
+                stream << (me.col_rows[k] + 1) << ' ';
+            stream << '\n';
+        }
+        return stream;
+    }
 }
@@ -17,148 +17,80 @@
 #include <memory>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <algorithm>
+#include <span>
+#include <cstdint>
+#include <stdexcept>
+
+#include "mod2_vector.hpp"
 
 using ::std::operator""s;
 using ::std::operator""sv;
 
 namespace sparse_matrix
 {
-    template <typename T>
-    class SparseMatrix
+    // Immutable binary sparse matrix stored as a flat Tanner graph.
+    // Edges are numbered in row-major order: the edges of row i are [row_offsets[i], row_offsets[i + 1]) and
+    // edge e connects to column edge_cols[e]. The column view is a permutation of the edge ids: the edges of
+    // column j are col_edges[col_offsets[j] .. col_offsets[j + 1]), whose rows are cached in col_rows.
+    // All arrays live in one shared block, so copies are cheap and share the same graph.
+    class Mod2SparseMatrix
     {
-    private: // types
-        struct Item
-        {
-            size_t row_index, col_index;
-            T value;
-        };
+    public: // types
+        using Index = uint32_t;
+
+    private: // members
+        size_t row, col, nnz;
+        // Owns the array block: a heap buffer, or a memory-mapped compiled graph file.
+        ::std::shared_ptr<void const> storage;
+        ::std::span<Index const> row_offsets, edge_cols, col_offsets, col_edges, col_rows;
 
-    public: // members
-        size_t row, col;
-        ::std::vector<::std::vector<::std::shared_ptr<Item>>> items_each_row, items_each_col;
+    private: // utils
+        // Number of indices in the block row_offsets | edge_cols | col_offsets | col_edges | col_rows.
+        static size_t blockLength(size_t row, size_t col, size_t nnz) { return (row + 1) + nnz + (col + 1) + 2 * nnz; }
+        void bind(::std::shared_ptr<void const> storage, Index const *block);
 
     public: // apis
-        SparseMatrix() : row{0}, col{0} {}
-        SparseMatrix(SparseMatrix const &that)
-        {
-            this->row = that.row;
-            this->col = that.col;
-            this->items_each_row.resize(this->row);
-            this->items_each_col.resize(this->col);
-            for (auto i{0ULL}; i < this->row; i++)
-            {
-                for (auto const &item : that.items_each_row[i])
-                {
-                    auto copy_item{::std::make_shared<Item>(*item)};
-                    this->items_each_row[i].push_back(copy_item);
-                    this->items_each_col[item->col_index].push_back(copy_item);
-                }
-            }
-        }
-        // Read alist file. See http://www.inference.org.uk/mackay/codes/alist.html
-        friend ::std::istream &operator>>(::std::istream &stream, SparseMatrix &me)
-        {
-            if (!stream)
-                throw ::std::runtime_error("Could not open alist file."s);
-            stream >> me.row >> me.col;
+        Mod2SparseMatrix() : row{0}, col{0}, nnz{0} {}
+        // Build from CSR arrays; `row_offsets` has row + 1 entries and `edge_cols` lists the column of every edge.
+        Mod2SparseMatrix(size_t row, size_t col, ::std::vector<Index> const &row_offsets, ::std::vector<Index> const &edge_cols);
 
-            size_t max_weight_forall_rows, max_weight_forall_cols;
-            stream >> max_weight_forall_rows >> max_weight_forall_cols;
-            if (max_weight_forall_rows > me.row || max_weight_forall_cols > me.col)
-                throw ::std::runtime_error("Unexpected EOF or invalid max_weight."s);
+        size_t rows() const { return this->row; }
+        size_t cols() const { return this->col; }
+        size_t edges() const { return this->nnz; }
+        ::std::span<Index const> rowOffsets() const { return this->row_offsets; }
+        ::std::span<Index const> edgeCols() const { return this->edge_cols; }
+        ::std::span<Index const> colOffsets() const { return this->col_offsets; }
+        ::std::span<Index const> colEdges() const { return this->col_edges; }
+        ::std::span<Index const> colRows() const { return this->col_rows; }
 
-            ::std::vector<size_t> weights_each_row(me.row), weights_each_col(me.col);
-            ::std::vector<::std::vector<size_t>> indexs_each_row, indexs_each_col;
-            for (auto &row_weight : weights_each_row)
-            {
-                stream >> row_weight;
-                if (row_weight > max_weight_forall_rows)
-                    throw ::std::runtime_error("Unexpected EOF or invalid row weight."s);
-                indexs_each_row.emplace_back(::std::vector<size_t>(row_weight));
-            }
-            for (auto &col_weight : weights_each_col)
-            {
-                stream >> col_weight;
-                if (col_weight > max_weight_forall_cols)
-                    throw ::std::runtime_error("Unexpected EOF or invalid col weight."s);
-                indexs_each_col.emplace_back(::std::vector<size_t>(col_weight));
-            }
-            for (auto &row : indexs_each_row)
-            {
-                for (auto &index : row)
-                {
-                    stream >> index; // start from 1
-                    index--;
-                    if (index >= me.col)
-                        throw ::std::runtime_error("Unexpected EOF or invalid index."s);
-                }
-            }
-            for (auto &col : indexs_each_col)
-            {
-                for (auto &index : col)
-                {
-                    stream >> index;
-                    index--;
-                    if (index >= me.row)
-                        throw ::std::runtime_error("Unexpected EOF or invalid index."s);
-                }
-            }
+        ::std::vector<uint8_t> operator*(::std::vector<uint8_t> const &vec) const;
+        // Same as operator*, writing into a caller-owned buffer of length rows().
+        void multiply(::std::span<uint8_t const> vec, ::std::span<uint8_t> result) const;
+        // Mat-vec on packed vectors. This is not word-parallel: it walks the set bits of `vec`, skipping zero
+        // words, and flips one result bit per edge of their columns, so the work is the same as the byte
+        // version but on buffers an eighth the size. Packed column images would cost rows() / 64 words per
+        // column, which sparse codes of interest cannot afford.
+        Mod2Vector operator*(Mod2Vector const &vec) const;
+        void multiply(Mod2Vector const &vec, Mod2Vector &result) const;
 
-            me.items_each_row.resize(me.row);
-            me.items_each_col.resize(me.col);
-            for (size_t i{0}; i < me.row; i++)
-            {
-                for (size_t j : indexs_each_row[i])
-                {
-                    auto item_ptr{::std::make_shared<Item>(i, j)};
-                    me.items_each_row[i].push_back(item_ptr);
-                    me.items_each_col[j].push_back(item_ptr);
-                }
-            }
-            return stream;
-        }
-        friend ::std::ostream &operator<<(::std::ostream &stream, SparseMatrix const &me)
-        {
-            ::std::vector<size_t> weights_each_row, weights_each_col;
-            for (auto const &row : me.items_each_row)
-                weights_each_row.push_back(row.size());
-            for (auto const &col : me.items_each_col)
-                weights_each_col.push_back(col.size());
-            auto max_weight_forall_rows = *::std::max_element(weights_each_row.begin(), weights_each_row.end()),
-                 max_weight_forall_cols = *::std::max_element(weights_each_col.begin(), weights_each_col.end());
+        // Parse alist text directly into the CSR arrays, without per-token stream extraction. The column lists
+        // must describe the same edges as the row lists.
+        static Mod2SparseMatrix parseAlist(::std::string_view text);
+        static Mod2SparseMatrix fromAlist(::std::string const &path);
+        // Compiled graph file: a versioned header with a checksum, followed by the array block verbatim.
+        // load() memory-maps the file, checks once that every offset and index is in range, and uses the arrays
+        // in place. `source` is an opaque fingerprint of whatever the matrix was built from, e.g. fingerprint()
+        // of the alist text; sourceOf() reads it back from the header so that a cache can detect a stale file.
+        void save(::std::string const &path, uint64_t source = 0) const;
+        static Mod2SparseMatrix load(::std::string const &path);
+        static uint64_t sourceOf(::std::string const &path);
+        static uint64_t fingerprint(::std::string_view bytes);
 
-            stream << me.row << ' ' << me.col << '\n'
-                   << max_weight_forall_rows << ' ' << max_weight_forall_cols << '\n';
-            for (auto row_weight : weights_each_row)
-                stream << row_weight << ' ';
-            stream << '\n';
-            for (auto col_weight : weights_each_col)
-                stream << col_weight << ' ';
-            stream << '\n';
-            for (auto const &row : me.items_each_row)
-            {
-                for (auto const &item : row)
-                    stream << (item->col_index + 1) << ' ';
-                stream << '\n';
-            }
-            for (auto const &col : me.items_each_col)
-            {
-                for (auto const &item : col)
-                    stream << (item->row_index + 1) << ' ';
-                stream << '\n';
-            }
-            return stream;
-        }
-    };
-    struct Prob
-    {
-        double prob_rate, like_rate;
-    };
-    class Mod2SparseMatrix : public SparseMatrix<Prob>
-    {
-    public: // extra api
-        ::std::vector<uint8_t> operator*(::std::vector<uint8_t> const &vec) const;
+        // Read alist file. See http://www.inference.org.uk/mackay/codes/alist.html
+        friend ::std::istream &operator>>(::std::istream &stream, Mod2SparseMatrix &me);
+        friend ::std::ostream &operator<<(::std::ostream &stream, Mod2SparseMatrix const &me);
     };
 }
 
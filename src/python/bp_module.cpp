@@ -0,0 +1,712 @@
+/** Copyright (c) 2023 Jim-shop
+ * bp is licensed under Mulan PubL v2.
+ * You can use this software according to the terms and conditions of the Mulan PubL v2.
+ * You may obtain a copy of Mulan PubL v2 at:
+ *          http://license.coscl.org.cn/MulanPubL-2.0
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ * See the Mulan PubL v2 for more details.
+ */
+// The `bp` Python module, written against the CPython and NumPy C APIs so that it builds with nothing beyond
+// the Python headers and NumPy. NumPy inputs that already are C-contiguous uint8 are read in place; batch entry
+// points release the GIL and split the shots over native threads, each with its own copy of the decoder.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include <span>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <algorithm>
+#include <exception>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#include "bp_decoder/bp_decoder.hpp"
+#include "sparse_matrix/sparse_matrix.hpp"
+#include "sparse_matrix/dem_file.hpp"
+
+using ::std::operator""s;
+
+using ::sparse_matrix::Mod2SparseMatrix;
+using ::bp_decoder::BpDecoder;
+using ::bp_decoder::OsdDecoder;
+using Index = Mod2SparseMatrix::Index;
+
+namespace
+{
+    // Thrown when a Python API call failed and already set the error; the entry point just returns NULL.
+    struct PythonError
+    {
+    };
+
+    struct DecRef
+    {
+        void operator()(PyObject *object) const { Py_XDECREF(object); }
+    };
+    using Ref = ::std::unique_ptr<PyObject, DecRef>;
+
+    // Take ownership of a new reference, turning NULL into PythonError.
+    Ref own(PyObject *object)
+    {
+        if (!object)
+            throw PythonError{};
+        return Ref{object};
+    }
+    Ref none()
+    {
+        Py_INCREF(Py_None);
+        return Ref{Py_None};
+    }
+    PyArrayObject *array(Ref const &ref)
+    {
+        return reinterpret_cast<PyArrayObject *>(ref.get());
+    }
+    template <typename T>
+    T *data(Ref const &ref)
+    {
+        return static_cast<T *>(PyArray_DATA(array(ref)));
+    }
+    // `object` as a C-contiguous array of `type`: the object itself when it already is one, a converted copy
+    // otherwise.
+    Ref asArray(PyObject *object, int type)
+    {
+        return own(PyArray_FROMANY(object, type, 0, 0, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST));
+    }
+    Ref newArray(::std::initializer_list<size_t> shape, int type)
+    {
+        npy_intp dims[2];
+        ::std::copy(shape.begin(), shape.end(), dims);
+        return own(PyArray_SimpleNew(static_cast<int>(shape.size()), dims, type));
+    }
+    // Keyword lists are declared const here; CPython takes them as char ** without writing to them.
+    char **keywords(char const *const *list)
+    {
+        return const_cast<char **>(list);
+    }
+
+    // Releases the GIL for its scope and takes it back before an exception leaves the scope.
+    class GilRelease
+    {
+    private: // members
+        PyThreadState *state;
+
+    public: // apis
+        GilRelease() : state{PyEval_SaveThread()} {}
+        GilRelease(GilRelease const &) = delete;
+        GilRelease &operator=(GilRelease const &) = delete;
+        ~GilRelease() { PyEval_RestoreThread(this->state); }
+    };
+
+    // Run the body of an entry point, translating C++ exceptions into Python ones.
+    template <typename Body>
+    PyObject *guard(Body const &body) noexcept
+    {
+        try
+        {
+            return body().release();
+        }
+        catch (PythonError const &)
+        {
+        }
+        catch (::std::invalid_argument const &err)
+        {
+            PyErr_SetString(PyExc_ValueError, err.what());
+        }
+        catch (::std::bad_alloc const &)
+        {
+            PyErr_NoMemory();
+        }
+        catch (::std::exception const &err)
+        {
+            PyErr_SetString(PyExc_RuntimeError, err.what());
+        }
+        return nullptr;
+    }
+
+    // Shots handed to a worker at a time; small enough to balance uneven BP run times.
+    constexpr size_t batch_chunk{64};
+
+    // Workers for `count` items on `threads` threads (all hardware threads when not positive), at least one.
+    size_t workerCount(size_t count, int threads)
+    {
+        auto const chunks{::std::max<size_t>((count + batch_chunk - 1) / batch_chunk, 1)};
+        return ::std::min<size_t>(threads > 0 ? threads : ::std::max(1U, ::std::thread::hardware_concurrency()), chunks);
+    }
+    // Run `work(id, take)` on `workers` threads, where `take(begin, end)` hands out chunks of [0, count) until
+    // none are left; the caller must not hold the GIL.
+    template <typename Work>
+    void parallelChunks(size_t count, size_t workers, Work const &work)
+    {
+        ::std::atomic<size_t> next{0};
+        ::std::exception_ptr error;
+        ::std::once_flag error_once;
+        auto const loop = [&](size_t id)
+        {
+            try
+            {
+                work(id, [&](size_t &begin, size_t &end)
+                     {
+                         begin = next.fetch_add(batch_chunk, ::std::memory_order_relaxed);
+                         end = ::std::min(begin + batch_chunk, count);
+                         return begin < count; });
+            }
+            catch (...)
+            {
+                ::std::call_once(error_once, [&]()
+                                 { error = ::std::current_exception(); });
+                next.store(count, ::std::memory_order_relaxed);
+            }
+        };
+        {
+            ::std::vector<::std::jthread> pool;
+            for (auto t{1ULL}; t < workers; t++)
+                pool.emplace_back(loop, t);
+            loop(0);
+        }
+        if (error)
+            ::std::rethrow_exception(error);
+    }
+
+    // bp.Mod2SparseMatrix
+    struct MatrixObject
+    {
+        PyObject_HEAD
+        Mod2SparseMatrix matrix;
+    };
+    PyTypeObject *matrix_type;
+
+    Mod2SparseMatrix &unwrap(PyObject *self)
+    {
+        return reinterpret_cast<MatrixObject *>(self)->matrix;
+    }
+    Ref wrap(Mod2SparseMatrix &&matrix)
+    {
+        auto object{own(matrix_type->tp_alloc(matrix_type, 0))};
+        new (&reinterpret_cast<MatrixObject *>(object.get())->matrix) Mod2SparseMatrix(::std::move(matrix));
+        return object;
+    }
+
+    // Rows of a canonical CSR matrix with index type I, keeping the entries whose value is odd.
+    template <typename I>
+    Mod2SparseMatrix readCsr(size_t rows, size_t cols, Ref const &indptr, Ref const &indices, Ref const &values)
+    {
+        auto const *const ptr{data<I>(indptr)};
+        auto const *const idx{data<I>(indices)};
+        auto const *const val{data<uint8_t>(values)};
+        auto const nnz{static_cast<size_t>(PyArray_SIZE(array(indices)))};
+        if (static_cast<size_t>(PyArray_SIZE(array(indptr))) != rows + 1 || static_cast<size_t>(PyArray_SIZE(array(values))) != nnz ||
+            ptr[0] != 0 || static_cast<size_t>(ptr[rows]) != nnz)
+            throw ::std::invalid_argument("Invalid CSR index arrays."s);
+        ::std::vector<Index> row_offsets{0}, edge_cols;
+        row_offsets.reserve(rows + 1);
+        edge_cols.reserve(nnz);
+        for (auto i{0ULL}; i < rows; i++)
+        {
+            if (ptr[i + 1] < ptr[i] || static_cast<size_t>(ptr[i + 1]) > nnz)
+                throw ::std::invalid_argument("Invalid CSR index arrays."s);
+            for (auto e{ptr[i]}; e < ptr[i + 1]; e++)
+            {
+                // Checked before narrowing, so a 64-bit index cannot wrap onto a valid column.
+                if (idx[e] < 0 || static_cast<size_t>(idx[e]) >= cols)
+                    throw ::std::invalid_argument("Column index out of range."s);
+                if (val[e] & 1)
+                    edge_cols.push_back(static_cast<Index>(idx[e]));
+            }
+            row_offsets.push_back(static_cast<Index>(edge_cols.size()));
+        }
+        return Mod2SparseMatrix(rows, cols, row_offsets, edge_cols);
+    }
+    // Accept anything scipy.sparse can turn into CSR. Duplicate entries are summed and kept only when odd, so
+    // the result is the matrix over GF(2).
+    Mod2SparseMatrix fromScipy(PyObject *matrix)
+    {
+        auto const scipy{own(PyImport_ImportModule("scipy.sparse"))};
+        auto csr{own(PyObject_CallMethod(scipy.get(), "csr_matrix", "O", matrix))};
+        auto const canonical{PyObject_IsTrue(own(PyObject_GetAttrString(csr.get(), "has_canonical_format")).get())};
+        if (canonical < 0)
+            throw PythonError{};
+        if (!canonical)
+        {
+            // csr_matrix() shares the caller's arrays, and canonicalizing sorts them in place.
+            csr = own(PyObject_CallMethod(csr.get(), "copy", nullptr));
+            own(PyObject_CallMethod(csr.get(), "sum_duplicates", nullptr));
+        }
+        Py_ssize_t rows, cols;
+        if (!PyArg_ParseTuple(own(PyObject_GetAttrString(csr.get(), "shape")).get(), "nn", &rows, &cols))
+            throw PythonError{};
+        // scipy stores int32 or int64 indices depending on the size; read either in place. Values only matter
+        // mod 2, which a cast to uint8 preserves for integers.
+        auto const indptr_object{own(PyObject_GetAttrString(csr.get(), "indptr"))};
+        auto const indices_object{own(PyObject_GetAttrString(csr.get(), "indices"))};
+        auto const values{asArray(own(PyObject_GetAttrString(csr.get(), "data")).get(), NPY_UINT8)};
+        auto const is_int32 = [](Ref const &object)
+        {
+            return PyArray_Check(object.get()) && PyArray_TYPE(array(object)) == NPY_INT32;
+        };
+        if (is_int32(indptr_object) && is_int32(indices_object))
+            return readCsr<int32_t>(rows, cols, asArray(indptr_object.get(), NPY_INT32), asArray(indices_object.get(), NPY_INT32), values);
+        return readCsr<int64_t>(rows, cols, asArray(indptr_object.get(), NPY_INT64), asArray(indices_object.get(), NPY_INT64), values);
+    }
+    template <typename I>
+    Ref indexArray(::std::span<Index const> indices, int type)
+    {
+        auto result{newArray({indices.size()}, type)};
+        ::std::copy(indices.begin(), indices.end(), data<I>(result));
+        return result;
+    }
+    Ref toScipy(Mod2SparseMatrix const &matrix)
+    {
+        auto const row_offsets{matrix.rowOffsets()}, edge_cols{matrix.edgeCols()};
+        // The index dtype scipy itself would pick, so csr_matrix() keeps the arrays as they are.
+        auto const narrow{::std::max({matrix.rows(), matrix.cols(), matrix.edges()}) <= INT32_MAX};
+        auto indptr{narrow ? indexArray<int32_t>(row_offsets, NPY_INT32) : indexArray<int64_t>(row_offsets, NPY_INT64)};
+        auto indices{narrow ? indexArray<int32_t>(edge_cols, NPY_INT32) : indexArray<int64_t>(edge_cols, NPY_INT64)};
+        auto values{newArray({edge_cols.size()}, NPY_UINT8)};
+        ::std::fill_n(data<uint8_t>(values), edge_cols.size(), uint8_t{1});
+        auto const scipy{own(PyImport_ImportModule("scipy.sparse"))};
+        auto const constructor{own(PyObject_GetAttrString(scipy.get(), "csr_matrix"))};
+        auto const args{own(Py_BuildValue("((NNN))", values.release(), indices.release(), indptr.release()))};
+        auto const kwargs{own(Py_BuildValue("{s:(nn)}", "shape", static_cast<Py_ssize_t>(matrix.rows()), static_cast<Py_ssize_t>(matrix.cols())))};
+        return own(PyObject_Call(constructor.get(), args.get(), kwargs.get()));
+    }
+
+    // H e for a 1-D error of length cols, or row by row for a 2-D (shots, cols) array.
+    Ref syndromes(Mod2SparseMatrix const &matrix, PyObject *errors_object, int threads)
+    {
+        auto const rows{matrix.rows()}, cols{matrix.cols()};
+        auto const errors{asArray(errors_object, NPY_UINT8)};
+        auto const ndim{PyArray_NDIM(array(errors))};
+        auto const *const dims{PyArray_DIMS(array(errors))};
+        if (ndim == 1)
+        {
+            if (static_cast<size_t>(dims[0]) != cols)
+                throw ::std::invalid_argument("Error length mismatch matrix col."s);
+            auto result{newArray({rows}, NPY_UINT8)};
+            matrix.multiply({data<uint8_t const>(errors), cols}, {data<uint8_t>(result), rows});
+            return result;
+        }
+        if (ndim != 2 || static_cast<size_t>(dims[1]) != cols)
+            throw ::std::invalid_argument("Errors must have shape (shots, matrix.cols)."s);
+        auto const shots{static_cast<size_t>(dims[0])};
+        auto result{newArray({shots, rows}, NPY_UINT8)};
+        auto const *const input{data<uint8_t const>(errors)};
+        auto *const output{data<uint8_t>(result)};
+        {
+            GilRelease release;
+            parallelChunks(shots, workerCount(shots, threads), [&](size_t, auto const &take)
+                           {
+                               size_t begin, end;
+                               while (take(begin, end))
+                                   for (auto s{begin}; s < end; s++)
+                                       matrix.multiply({input + s * cols, cols}, {output + s * rows, rows}); });
+        }
+        return result;
+    }
+
+    PyObject *matrixNew(PyTypeObject *, PyObject *args, PyObject *kwargs)
+    {
+        return guard([&]()
+                     {
+                         static char const *const list[]{"matrix", nullptr};
+                         PyObject *matrix;
+                         if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O:Mod2SparseMatrix", keywords(list), &matrix))
+                             throw PythonError{};
+                         return wrap(fromScipy(matrix)); });
+    }
+    void matrixDealloc(PyObject *self)
+    {
+        auto *const type{Py_TYPE(self)};
+        unwrap(self).~Mod2SparseMatrix();
+        type->tp_free(self);
+        Py_DECREF(type);
+    }
+    // Static constructors taking a path: from_alist() and load().
+    template <Mod2SparseMatrix (*Read)(::std::string const &)>
+    PyObject *matrixRead(PyObject *, PyObject *args, PyObject *kwargs)
+    {
+        return guard([&]()
+                     {
+                         static char const *const list[]{"path", nullptr};
+                         char const *path;
+                         if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", keywords(list), &path))
+                             throw PythonError{};
+                         return wrap(Read(path)); });
+    }
+    PyObject *matrixSave(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        return guard([&]()
+                     {
+                         static char const *const list[]{"path", nullptr};
+                         char const *path;
+                         if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", keywords(list), &path))
+                             throw PythonError{};
+                         unwrap(self).save(path);
+                         return none(); });
+    }
+    PyObject *matrixToScipy(PyObject *self, PyObject *)
+    {
+        return guard([&]()
+                     { return toScipy(unwrap(self)); });
+    }
+    PyObject *matrixSyndromes(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        return guard([&]()
+                     {
+                         static char const *const list[]{"errors", "threads", nullptr};
+                         PyObject *errors;
+                         int threads{0};
+                         if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", keywords(list), &errors, &threads))
+                             throw PythonError{};
+                         return syndromes(unwrap(self), errors, threads); });
+    }
+    PyObject *matrixRows(PyObject *self, void *) { return PyLong_FromSize_t(unwrap(self).rows()); }
+    PyObject *matrixCols(PyObject *self, void *) { return PyLong_FromSize_t(unwrap(self).cols()); }
+    PyObject *matrixEdges(PyObject *self, void *) { return PyLong_FromSize_t(unwrap(self).edges()); }
+    PyObject *matrixShape(PyObject *self, void *)
+    {
+        return Py_BuildValue("(nn)", static_cast<Py_ssize_t>(unwrap(self).rows()), static_cast<Py_ssize_t>(unwrap(self).cols()));
+    }
+
+    template <typename Function>
+    PyCFunction method(Function *function)
+    {
+        return reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(function));
+    }
+
+    PyMethodDef matrix_methods[]{
+        {"from_alist", method(&matrixRead<&Mod2SparseMatrix::fromAlist>), METH_VARARGS | METH_KEYWORDS | METH_STATIC,
+         "from_alist(path)\n--\n\nParse an alist file."},
+        {"load", method(&matrixRead<&Mod2SparseMatrix::load>), METH_VARARGS | METH_KEYWORDS | METH_STATIC,
+         "load(path)\n--\n\nMemory-map a compiled graph file."},
+        {"save", method(&matrixSave), METH_VARARGS | METH_KEYWORDS, "save(path)\n--\n\nWrite a compiled graph file."},
+        {"to_scipy", method(&matrixToScipy), METH_NOARGS, "to_scipy()\n--\n\nThe matrix as a scipy.sparse.csr_matrix."},
+        {"syndromes", method(&matrixSyndromes), METH_VARARGS | METH_KEYWORDS,
+         "syndromes(errors, threads=0)\n--\n\nH e of a 1-D error, or of every row of a 2-D (shots, cols) array."},
+        {nullptr, nullptr, 0, nullptr}};
+    PyGetSetDef matrix_getset[]{
+        {"rows", &matrixRows, nullptr, nullptr, nullptr},
+        {"cols", &matrixCols, nullptr, nullptr, nullptr},
+        {"edges", &matrixEdges, nullptr, nullptr, nullptr},
+        {"shape", &matrixShape, nullptr, nullptr, nullptr},
+        {nullptr, nullptr, nullptr, nullptr, nullptr}};
+    PyType_Slot matrix_slots[]{
+        {Py_tp_doc, const_cast<char *>("Mod2SparseMatrix(matrix)\n--\n\n"
+                                       "Build from a scipy.sparse matrix (or anything scipy.sparse.csr_matrix accepts), reduced mod 2.")},
+        {Py_tp_new, reinterpret_cast<void *>(&matrixNew)},
+        {Py_tp_dealloc, reinterpret_cast<void *>(&matrixDealloc)},
+        {Py_tp_methods, matrix_methods},
+        {Py_tp_getset, matrix_getset},
+        {0, nullptr}};
+    PyType_Spec matrix_spec{"bp.Mod2SparseMatrix", sizeof(MatrixObject), 0, Py_TPFLAGS_DEFAULT, matrix_slots};
+
+    // The decoder as seen from Python: a configured BpDecoder plus the matrix it is bound to, so batches can be
+    // checked and the decoder replicated per worker thread.
+    class PyBpDecoder
+    {
+    private: // vars
+        Mod2SparseMatrix matrix;
+        BpDecoder decoder;
+
+    private: // utils
+        static BpDecoder::Method methodFromName(::std::string const &name)
+        {
+            if (name == "min_sum"s)
+                return BpDecoder::Method::MIN_SUM;
+            if (name == "product_sum"s)
+                return BpDecoder::Method::PRODUCT_SUM;
+            if (name == "quantized_min_sum"s)
+                return BpDecoder::Method::QUANTIZED_MIN_SUM;
+            throw ::std::invalid_argument("Unknown method: "s + name);
+        }
+        static BpDecoder::Schedule scheduleFromName(::std::string const &name)
+        {
+            if (name == "flooding"s)
+                return BpDecoder::Schedule::FLOODING;
+            if (name == "layered"s)
+                return BpDecoder::Schedule::LAYERED;
+            throw ::std::invalid_argument("Unknown schedule: "s + name);
+        }
+        static OsdDecoder::Method osdFromName(::std::string const &name)
+        {
+            if (name == "osd_0"s)
+                return OsdDecoder::Method::OSD_0;
+            if (name == "osd_e"s)
+                return OsdDecoder::Method::OSD_E;
+            if (name == "osd_cs"s)
+                return OsdDecoder::Method::OSD_CS;
+            throw ::std::invalid_argument("Unknown osd method: "s + name);
+        }
+        // A 1-D float64 array of one value per column.
+        ::std::span<double const> columnValues(Ref const &values) const
+        {
+            if (PyArray_NDIM(array(values)) != 1)
+                throw ::std::invalid_argument("Priors must be a 1-D array."s);
+            return {data<double const>(values), static_cast<size_t>(PyArray_SIZE(array(values)))};
+        }
+
+    public: // apis
+        PyBpDecoder(Mod2SparseMatrix const &matrix, double error_rate, int max_iter, ::std::string const &method, ::std::string const &schedule)
+            : matrix{matrix}, decoder{matrix, methodFromName(method), error_rate, max_iter, scheduleFromName(schedule)} {}
+
+        void setQuantization(int bits, double scale) { this->decoder.setQuantization(bits, scale); }
+        void setSyndromeLookup(bool enabled) { this->decoder.setSyndromeLookup(enabled); }
+        void setFlip(int max_steps) { this->decoder.setFlip(max_steps); }
+        void setOsd(::std::string const &method, int order) { this->decoder.setOsd(osdFromName(method), order); }
+        void setPriors(PyObject *error_probs)
+        {
+            this->decoder.setPriors(this->columnValues(asArray(error_probs, NPY_DOUBLE)));
+        }
+        void setPriorLlrs(PyObject *log_prob_ratios)
+        {
+            this->decoder.setPriorLlrs(this->columnValues(asArray(log_prob_ratios, NPY_DOUBLE)));
+        }
+
+        Ref decode(PyObject *syndrome_object)
+        {
+            auto const rows{this->matrix.rows()}, cols{this->matrix.cols()};
+            auto const syndrome{asArray(syndrome_object, NPY_UINT8)};
+            if (PyArray_NDIM(array(syndrome)) != 1 || static_cast<size_t>(PyArray_DIM(array(syndrome), 0)) != rows)
+                throw ::std::invalid_argument("Syndrome length mismatch matrix row."s);
+            auto const result{this->decoder.decode(::std::span<uint8_t const>{data<uint8_t const>(syndrome), rows})};
+            auto decoding{newArray({cols}, NPY_UINT8)};
+            auto log_prob_ratios{newArray({cols}, NPY_DOUBLE)};
+            ::std::copy(result.decoding.begin(), result.decoding.end(), data<uint8_t>(decoding));
+            ::std::copy(result.log_prob_ratios.begin(), result.log_prob_ratios.end(), data<double>(log_prob_ratios));
+            return own(Py_BuildValue("{s:N,s:N,s:n,s:N,s:N,s:N}",
+                                     "decoding", decoding.release(),
+                                     "log_prob_ratios", log_prob_ratios.release(),
+                                     "iterations", static_cast<Py_ssize_t>(result.iter),
+                                     "converged", PyBool_FromLong(result.converge),
+                                     "post_processed", PyBool_FromLong(result.post_processed),
+                                     "looked_up", PyBool_FromLong(result.looked_up)));
+        }
+        // Decode a (shots, rows) array; returns (decodings, converged, iterations, post_processed, looked_up).
+        Ref decodeBatch(PyObject *syndromes_object, int threads) const
+        {
+            auto const rows{this->matrix.rows()}, cols{this->matrix.cols()};
+            auto const syndromes{asArray(syndromes_object, NPY_UINT8)};
+            if (PyArray_NDIM(array(syndromes)) != 2 || static_cast<size_t>(PyArray_DIM(array(syndromes), 1)) != rows)
+                throw ::std::invalid_argument("Syndromes must have shape (shots, matrix.rows)."s);
+            auto const shots{static_cast<size_t>(PyArray_DIM(array(syndromes), 0))};
+            auto decodings{newArray({shots, cols}, NPY_UINT8)};
+            auto converged{newArray({shots}, NPY_BOOL)}, post_processed{newArray({shots}, NPY_BOOL)}, looked_up{newArray({shots}, NPY_BOOL)};
+            auto iterations{newArray({shots}, NPY_UINT32)};
+
+            auto const *const input{data<uint8_t const>(syndromes)};
+            auto *const out_decodings{data<uint8_t>(decodings)};
+            auto *const out_converged{data<npy_bool>(converged)};
+            auto *const out_post_processed{data<npy_bool>(post_processed)};
+            auto *const out_looked_up{data<npy_bool>(looked_up)};
+            auto *const out_iterations{data<uint32_t>(iterations)};
+            // Each worker owns a copy, since the decoder carries its own workspace. The copies are made while the
+            // GIL is still held: once it is released another Python thread may reconfigure this decoder.
+            ::std::vector<BpDecoder> decoders(workerCount(shots, threads), this->decoder);
+            {
+                GilRelease release;
+                parallelChunks(shots, decoders.size(), [&](size_t id, auto const &take)
+                               {
+                                   auto &decoder{decoders[id]};
+                                   size_t begin, end;
+                                   while (take(begin, end))
+                                   {
+                                       for (auto s{begin}; s < end; s++)
+                                       {
+                                           auto const result{decoder.decode(::std::span<uint8_t const>{input + s * rows, rows})};
+                                           ::std::copy(result.decoding.begin(), result.decoding.end(), out_decodings + s * cols);
+                                           out_converged[s] = result.converge;
+                                           out_post_processed[s] = result.post_processed;
+                                           out_looked_up[s] = result.looked_up;
+                                           out_iterations[s] = static_cast<uint32_t>(result.iter);
+                                       }
+                                   } });
+            }
+            return own(Py_BuildValue("(NNNNN)", decodings.release(), converged.release(), iterations.release(),
+                                     post_processed.release(), looked_up.release()));
+        }
+    };
+
+    // bp.BpDecoder
+    struct DecoderObject
+    {
+        PyObject_HEAD
+        PyBpDecoder decoder;
+    };
+
+    PyBpDecoder &decoderOf(PyObject *self)
+    {
+        return reinterpret_cast<DecoderObject *>(self)->decoder;
+    }
+    PyObject *decoderNew(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+    {
+        return guard([&]()
+                     {
+                         static char const *const list[]{"matrix", "error_rate", "max_iter", "method", "schedule", nullptr};
+                         PyObject *matrix;
+                         double error_rate;
+                         int max_iter;
+                         char const *method{"min_sum"}, *schedule{"flooding"};
+                         if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!di|ss:BpDecoder", keywords(list), matrix_type, &matrix,
+                                                          &error_rate, &max_iter, &method, &schedule))
+                             throw PythonError{};
+                         PyBpDecoder decoder{unwrap(matrix), error_rate, max_iter, method, schedule};
+                         auto object{own(type->tp_alloc(type, 0))};
+                         new (&decoderOf(object.get())) PyBpDecoder(::std::move(decoder));
+                         return object; });
+    }
+    void decoderDealloc(PyObject *self)
+    {
+        auto *const type{Py_TYPE(self)};
+        decoderOf(self).~PyBpDecoder();
+        type->tp_free(self);
+        Py_DECREF(type);
+    }
+    // Parse `format` into `values...` and run `body`; setters return None.
+    template <typename Body, typename... Values>
+    PyObject *decoderCall(PyObject *args, PyObject *kwargs, char const *format, char const *const *list, Body const &body, Values *...values)
+    {
+        return guard([&]()
+                     {
+                         if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords(list), values...))
+                             throw PythonError{};
+                         if constexpr (::std::is_void_v<decltype(body())>)
+                         {
+                             body();
+                             return none();
+                         }
+                         else
+                             return body(); });
+    }
+    PyObject *decoderSetQuantization(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        static char const *const list[]{"bits", "scale", nullptr};
+        int bits;
+        double scale;
+        return decoderCall(args, kwargs, "id", list, [&]()
+                           { decoderOf(self).setQuantization(bits, scale); }, &bits, &scale);
+    }
+    PyObject *decoderSetSyndromeLookup(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        static char const *const list[]{"enabled", nullptr};
+        int enabled;
+        return decoderCall(args, kwargs, "p", list, [&]()
+                           { decoderOf(self).setSyndromeLookup(enabled); }, &enabled);
+    }
+    PyObject *decoderSetFlip(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        static char const *const list[]{"max_steps", nullptr};
+        int max_steps;
+        return decoderCall(args, kwargs, "i", list, [&]()
+                           { decoderOf(self).setFlip(max_steps); }, &max_steps);
+    }
+    PyObject *decoderSetOsd(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        static char const *const list[]{"method", "order", nullptr};
+        char const *method;
+        int order{0};
+        return decoderCall(args, kwargs, "s|i", list, [&]()
+                           { decoderOf(self).setOsd(method, order); }, &method, &order);
+    }
+    PyObject *decoderSetPriors(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        static char const *const list[]{"error_probs", nullptr};
+        PyObject *error_probs;
+        return decoderCall(args, kwargs, "O", list, [&]()
+                           { decoderOf(self).setPriors(error_probs); }, &error_probs);
+    }
+    PyObject *decoderSetPriorLlrs(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        static char const *const list[]{"log_prob_ratios", nullptr};
+        PyObject *log_prob_ratios;
+        return decoderCall(args, kwargs, "O", list, [&]()
+                           { decoderOf(self).setPriorLlrs(log_prob_ratios); }, &log_prob_ratios);
+    }
+    PyObject *decoderDecode(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        static char const *const list[]{"syndrome", nullptr};
+        PyObject *syndrome;
+        return decoderCall(args, kwargs, "O", list, [&]()
+                           { return decoderOf(self).decode(syndrome); }, &syndrome);
+    }
+    PyObject *decoderDecodeBatch(PyObject *self, PyObject *args, PyObject *kwargs)
+    {
+        static char const *const list[]{"syndromes", "threads", nullptr};
+        PyObject *syndromes;
+        int threads{0};
+        return decoderCall(args, kwargs, "O|i", list, [&]()
+                           { return decoderOf(self).decodeBatch(syndromes, threads); }, &syndromes, &threads);
+    }
+
+    PyMethodDef decoder_methods[]{
+        {"set_quantization", method(&decoderSetQuantization), METH_VARARGS | METH_KEYWORDS, "set_quantization(bits, scale)\n--\n\n"},
+        {"set_syndrome_lookup", method(&decoderSetSyndromeLookup), METH_VARARGS | METH_KEYWORDS, "set_syndrome_lookup(enabled)\n--\n\n"},
+        {"set_flip", method(&decoderSetFlip), METH_VARARGS | METH_KEYWORDS, "set_flip(max_steps)\n--\n\n"},
+        {"set_osd", method(&decoderSetOsd), METH_VARARGS | METH_KEYWORDS, "set_osd(method, order=0)\n--\n\n"},
+        {"set_priors", method(&decoderSetPriors), METH_VARARGS | METH_KEYWORDS,
+         "set_priors(error_probs)\n--\n\nPer-bit error probabilities in (0, 0.5]."},
+        {"set_prior_llrs", method(&decoderSetPriorLlrs), METH_VARARGS | METH_KEYWORDS,
+         "set_prior_llrs(log_prob_ratios)\n--\n\nPer-bit LLRs log((1 - p) / p), non-negative."},
+        {"decode", method(&decoderDecode), METH_VARARGS | METH_KEYWORDS,
+         "decode(syndrome)\n--\n\nDecode one syndrome; returns a dict of decoding, log_prob_ratios, iterations, converged, "
+         "post_processed and looked_up."},
+        {"decode_batch", method(&decoderDecodeBatch), METH_VARARGS | METH_KEYWORDS,
+         "decode_batch(syndromes, threads=0)\n--\n\nDecode a (shots, rows) uint8 array without holding the GIL; returns "
+         "(decodings, converged, iterations, post_processed, looked_up)."},
+        {nullptr, nullptr, 0, nullptr}};
+    PyType_Slot decoder_slots[]{
+        {Py_tp_doc, const_cast<char *>("BpDecoder(matrix, error_rate, max_iter, method='min_sum', schedule='flooding')\n--\n\n"
+                                       "Belief propagation decoder bound to one matrix; methods are min_sum, product_sum and "
+                                       "quantized_min_sum, schedules flooding and layered; error_rate is in (0, 0.5].")},
+        {Py_tp_new, reinterpret_cast<void *>(&decoderNew)},
+        {Py_tp_dealloc, reinterpret_cast<void *>(&decoderDealloc)},
+        {Py_tp_methods, decoder_methods},
+        {0, nullptr}};
+    PyType_Spec decoder_spec{"bp.BpDecoder", sizeof(DecoderObject), 0, Py_TPFLAGS_DEFAULT, decoder_slots};
+
+    PyObject *loadDem(PyObject *, PyObject *args, PyObject *kwargs)
+    {
+        return guard([&]()
+                     {
+                         static char const *const list[]{"path", nullptr};
+                         char const *path;
+                         if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", keywords(list), &path))
+                             throw PythonError{};
+                         auto dem{::sparse_matrix::DetectorErrorModel::fromFile(path)};
+                         auto check_matrix{wrap(::std::move(dem.check_matrix))}, observables{wrap(::std::move(dem.observables))};
+                         auto priors{newArray({dem.priors.size()}, NPY_DOUBLE)};
+                         ::std::copy(dem.priors.begin(), dem.priors.end(), data<double>(priors));
+                         return own(Py_BuildValue("(NNN)", check_matrix.release(), observables.release(), priors.release())); });
+    }
+
+    PyMethodDef module_methods[]{
+        {"load_dem", method(&loadDem), METH_VARARGS | METH_KEYWORDS,
+         "load_dem(path)\n--\n\nParse a Stim .dem file into (check_matrix, observables, priors), one column per mechanism."},
+        {nullptr, nullptr, 0, nullptr}};
+    PyModuleDef module_def{PyModuleDef_HEAD_INIT, "bp", "Belief propagation decoder for sparse binary codes.", -1, module_methods,
+                         nullptr, nullptr, nullptr, nullptr};
+}
+
+PyMODINIT_FUNC PyInit_bp()
+{
+    import_array();
+    auto *const module{PyModule_Create(&module_def)};
+    if (!module)
+        return nullptr;
+    // The types live as long as the process; the module holds one more reference each.
+    matrix_type = reinterpret_cast<PyTypeObject *>(PyType_FromSpec(&matrix_spec));
+    auto *const decoder_type{reinterpret_cast<PyTypeObject *>(PyType_FromSpec(&decoder_spec))};
+    if (!matrix_type || !decoder_type || PyModule_AddType(module, matrix_type) < 0 || PyModule_AddType(module, decoder_type) < 0)
+    {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
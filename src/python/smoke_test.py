@@ -0,0 +1,127 @@
+# Copyright (c) 2023 Jim-shop
+# bp is licensed under Mulan PubL v2.
+# You can use this software according to the terms and conditions of the Mulan PubL v2.
+# You may obtain a copy of Mulan PubL v2 at:
+#          http://license.coscl.org.cn/MulanPubL-2.0
+# THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+# EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+# MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+# See the Mulan PubL v2 for more details.
+"""Smoke test of the bp module: python smoke_test.py <alist>, with the built module on PYTHONPATH."""
+import os
+import sys
+import tempfile
+import threading
+
+import numpy as np
+import scipy.sparse as sp
+
+import bp
+
+
+def check_scipy(alist):
+    h = bp.Mod2SparseMatrix.from_alist(alist)
+    csr = h.to_scipy()
+    assert csr.shape == h.shape == (h.rows, h.cols) and csr.nnz == h.edges
+    # int32 and int64 index arrays are both read natively; duplicates add up mod 2.
+    for dtype in (np.int32, np.int64):
+        same = sp.csr_matrix((csr.data.astype(np.int64), csr.indices.astype(dtype), csr.indptr.astype(dtype)), shape=csr.shape)
+        assert (bp.Mod2SparseMatrix(same).to_scipy() != csr).nnz == 0
+    coo = sp.coo_matrix(([1, 1, 1, 3], ([0, 0, 1, 1], [2, 2, 0, 1])), shape=(2, 3))
+    assert bp.Mod2SparseMatrix(coo).to_scipy().toarray().tolist() == [[0, 0, 0], [1, 1, 0]]
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "h.bpg")
+        h.save(path)
+        assert (bp.Mod2SparseMatrix.load(path).to_scipy() != csr).nnz == 0
+    return h
+
+
+def check_decode(h):
+    rng = np.random.default_rng(1)
+    errors = (rng.random((300, h.cols)) < 0.01).astype(np.uint8)
+    syndromes = h.syndromes(errors, threads=2)
+    assert syndromes.shape == (300, h.rows)
+    assert np.array_equal(syndromes[0], h.syndromes(errors[0]))
+
+    decoder = bp.BpDecoder(h, error_rate=0.01, max_iter=30, method="min_sum", schedule="flooding")
+    decoder.set_osd("osd_cs", 4)
+    result = decoder.decode(np.zeros(h.rows, dtype=np.uint8))
+    assert result["converged"] and not result["decoding"].any()
+    # Batches are decoded by copies of the configured decoder, so they match shot by shot; a non-uint8,
+    # non-contiguous input is converted first.
+    decodings, converged, iterations, post_processed, looked_up = decoder.decode_batch(np.asfortranarray(syndromes, dtype=np.int64), threads=3)
+    for s in range(0, 300, 37):
+        result = decoder.decode(syndromes[s])
+        assert np.array_equal(result["decoding"], decodings[s])
+        assert (result["converged"], result["iterations"], result["post_processed"], result["looked_up"]) == \
+            (converged[s], iterations[s], post_processed[s], looked_up[s])
+    # Every accepted decoding reproduces its syndrome.
+    accepted = converged | post_processed
+    assert accepted.any() and np.array_equal(h.syndromes(decodings)[accepted], syndromes[accepted])
+
+    # decode_batch copies the decoder before releasing the GIL, so reconfiguring it meanwhile is safe.
+    stop = threading.Event()
+
+    def reconfigure():
+        while not stop.is_set():
+            decoder.set_osd("osd_e", 2)
+            decoder.set_priors(np.full(h.cols, 0.02))
+
+    thread = threading.Thread(target=reconfigure)
+    thread.start()
+    try:
+        for _ in range(20):
+            assert decoder.decode_batch(syndromes, threads=4)[0].shape == (300, h.cols)
+    finally:
+        stop.set()
+        thread.join()
+
+    decoder.set_priors(np.full(h.cols, 0.02))
+    try:
+        decoder.set_priors(np.full(h.cols, 0.6))
+        raise AssertionError("priors above 0.5 accepted")
+    except ValueError:
+        pass
+    for error_rate in (0.0, 0.6, float("nan")):
+        try:
+            bp.BpDecoder(h, error_rate=error_rate, max_iter=30)
+            raise AssertionError("error_rate outside (0, 0.5] accepted")
+        except ValueError:
+            pass
+
+
+def check_lookup():
+    # Repetition code: every single error has a syndrome of weight 1 or 2.
+    n = 7
+    h = bp.Mod2SparseMatrix(sp.csr_matrix(np.eye(n - 1, n, dtype=np.uint8) + np.eye(n - 1, n, 1, dtype=np.uint8)))
+    decoder = bp.BpDecoder(h, error_rate=0.05, max_iter=10)
+    decoder.set_syndrome_lookup(True)
+    errors = np.eye(n, dtype=np.uint8)
+    decodings, converged, iterations, post_processed, looked_up = decoder.decode_batch(h.syndromes(errors))
+    assert looked_up.all() and not converged.any() and np.array_equal(decodings, errors)
+
+
+def check_dem():
+    text = "\n".join([
+        "error(0.1) D0 D1 L0",
+        "error(0.2) D1 D0 L0",
+        "detector_separator",
+        "error(0.05) D1 ^ D2",
+        "detector(0, 1) D3",
+        "logical_observable L1",
+    ])
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "model.dem")
+        with open(path, "w") as file:
+            file.write(text)
+        check_matrix, observables, priors = bp.load_dem(path)
+    assert check_matrix.shape == (4, 2) and observables.shape == (2, 2)
+    assert np.allclose(priors, [0.1 * 0.8 + 0.2 * 0.9, 0.05])
+    assert check_matrix.to_scipy().toarray().tolist() == [[1, 0], [1, 1], [0, 1], [0, 0]]
+
+
+if __name__ == "__main__":
+    check_decode(check_scipy(sys.argv[1]))
+    check_lookup()
+    check_dem()
+    print("ok")
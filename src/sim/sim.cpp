@@ -15,11 +15,32 @@
 #include <chrono>
 #include <random>
 #include <functional>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <optional>
+#include <cmath>
+#include <type_traits>
+#include <variant>
+#include <array>
+#include <bit>
+#include <limits>
+#include <span>
+#include <exception>
+#include <utility>
 
 #include "nlohmann/json.hpp"
 
 #include "bp_decoder/bp_decoder.hpp"
+#include "bp_decoder/batch_bp_decoder.hpp"
 #include "sparse_matrix/sparse_matrix.hpp"
+#include "sparse_matrix/mod2_vector.hpp"
+#include "sparse_matrix/code_construction.hpp"
+#include "sparse_matrix/dem_file.hpp"
 
 using ::std::operator""s;
 using ::std::operator""sv;
@@ -54,17 +75,406 @@ template <>
     return stream;
 }
 
+// xoshiro256**：32 字节状态，每次输出只需几次移位和乘法，比 mt19937 轻量得多
+class Xoshiro256ss
+{
+    ::std::array<uint64_t, 4> state;
+
+    static uint64_t splitmix64(uint64_t &x)
+    {
+        auto z{x += 0x9e3779b97f4a7c15ULL};
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+    using result_type = uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    // 由 splitmix64 把 (seed, stream) 展开为初始状态
+    Xoshiro256ss(uint64_t seed, uint64_t stream)
+    {
+        auto x{seed};
+        x = splitmix64(x) ^ stream;
+        for (auto &word : this->state)
+            word = splitmix64(x);
+    }
+    result_type operator()()
+    {
+        auto &s{this->state};
+        auto const result{::std::rotl(s[1] * 5, 7) * 9};
+        auto const t{s[1] << 17};
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = ::std::rotl(s[3], 45);
+        return result;
+    }
+};
+
+// 按位打包生成相互独立的比特翻转错误，各比特概率相同，或由 priors 逐比特给出
+// 每个 stream 由 (random_seed, stream) 独立派生，结果与线程数和调度顺序无关
+class ErrorSampler
+{
+public: // types
+    enum class Method
+    {
+        // 每个比特一次随机数与阈值比较
+        BERNOULLI,
+        // 相邻翻转位置的间隔服从几何分布，每个翻转只需一次随机数，p 很小时远快于逐比特抽样
+        GEOMETRIC
+    };
+    enum class Engine
+    {
+        MT19937,
+        XOSHIRO256SS
+    };
+
+private: // vars
+    Method method;
+    ::std::variant<::std::mt19937, ::Xoshiro256ss> engine;
+    uint32_t threshold;
+    double inv_log_q; // 1 / log(1 - p)
+    double bit_error_rate;
+    ::std::span<double const> priors; // 为空时各比特的概率均为 bit_error_rate
+
+private: // utils
+    static ::std::variant<::std::mt19937, ::Xoshiro256ss> makeEngine(Engine engine, uint32_t random_seed, uint64_t stream)
+    {
+        if (engine == Engine::XOSHIRO256SS)
+            return ::Xoshiro256ss{random_seed, stream};
+        ::std::seed_seq seq{random_seed, static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)};
+        return ::std::mt19937{seq};
+    }
+    // (0, 1] 上的均匀分布，53 位精度
+    template <typename E>
+    static double uniform(E &engine)
+    {
+        uint64_t bits;
+        if constexpr (E::max() == UINT64_MAX)
+            bits = engine();
+        else
+        {
+            bits = static_cast<uint64_t>(engine()) << 32;
+            bits |= static_cast<uint64_t>(engine());
+        }
+        return static_cast<double>((bits >> 11) + 1) * 0x1p-53;
+    }
+    template <typename E>
+    static uint32_t draw32(E &engine)
+    {
+        if constexpr (E::max() == UINT64_MAX)
+            return static_cast<uint32_t>(engine() >> 32);
+        else
+            return static_cast<uint32_t>(engine());
+    }
+
+public: // apis
+    // 指定 priors 时 bit_error_rate 须为其最大值
+    ErrorSampler(Method method, Engine engine, uint32_t random_seed, uint64_t stream, double bit_error_rate, ::std::span<double const> priors = {})
+        : method{method}, engine{makeEngine(engine, random_seed, stream)},
+          threshold{static_cast<uint32_t>(bit_error_rate * UINT32_MAX)},
+          inv_log_q{1 / ::std::log1p(-bit_error_rate)},
+          bit_error_rate{bit_error_rate}, priors{priors}
+    {
+    }
+    // 覆盖写入 error，返回是否产生了错误
+    bool operator()(::sparse_matrix::Mod2Vector &error)
+    {
+        return ::std::visit([this, &error](auto &engine)
+                            { return this->method == Method::GEOMETRIC ? this->sampleGeometric(engine, error)
+                                                                       : this->sampleBernoulli(engine, error); },
+                            this->engine);
+    }
+    template <typename E>
+    bool sampleBernoulli(E &engine, ::sparse_matrix::Mod2Vector &error) const
+    {
+        auto words{error.words()};
+        uint64_t has_error{0};
+        for (auto w{0ULL}; w < words.size(); w++)
+        {
+            uint64_t word{0};
+            for (size_t b{0}, n{::std::min<size_t>(64, error.size() - w * 64)}; b < n; b++)
+            {
+                auto const threshold{this->priors.empty() ? this->threshold : static_cast<uint32_t>(this->priors[w * 64 + b] * UINT32_MAX)};
+                word |= static_cast<uint64_t>(draw32(engine) < threshold) << b;
+            }
+            words[w] = word;
+            has_error |= word;
+        }
+        return has_error != 0;
+    }
+    template <typename E>
+    bool sampleGeometric(E &engine, ::sparse_matrix::Mod2Vector &error) const
+    {
+        error.clear();
+        auto words{error.words()};
+        auto const length{error.size()};
+        auto has_error{false};
+        for (size_t pos{0};; pos++)
+        {
+            // 下一个翻转之前的无错比特数 floor(log(U) / log(1 - p))，以浮点比较避免溢出
+            auto const gap{::std::floor(::std::log(uniform(engine)) * this->inv_log_q)};
+            if (!(gap < static_cast<double>(length - pos)))
+                break;
+            pos += static_cast<size_t>(gap);
+            // 逐比特概率时按最大概率抽取候选位置，再以 p_j / p_max 保留，每个比特的翻转概率恰为 p_j
+            if (!this->priors.empty() && !(uniform(engine) * this->bit_error_rate <= this->priors[pos]))
+                continue;
+            words[pos / 64] |= uint64_t{1} << (pos % 64);
+            has_error = true;
+        }
+        return has_error;
+    }
+};
+
 class Config
 {
 public: // data
     int random_seed;
     int target_runs;
     ::bp_decoder::BpDecoder::Method bp_method;
+    ::bp_decoder::BpDecoder::Schedule schedule;
     double bit_error_rate;
     int max_iter;
     ::std::string hx_alist;
+    ::std::string hx_graph;
+    // 内置码构造，code_family 为空时从 hx_alist 读取校验矩阵
+    ::std::string code_family;
+    int code_distance;                  // toric、surface
+    ::std::string code_h1, code_h2;     // hgp
+    int code_size;                      // bicycle
+    ::std::vector<uint32_t> code_a, code_b;
+    bool code_z_checks;                 // 使用 hz 而非 hx 作为校验矩阵
+    ::std::string lx_alist;
+    // 逐比特错误概率文件，指定时取代 bit_error_rate，既用于抽样错误也作为译码先验
+    ::std::string priors;
+    // Stim 探测器错误模型，指定时由其给出校验矩阵、逻辑算符矩阵与逐列错误概率
+    ::std::string dem;
+    // 扫描的取值，仿真其笛卡尔积；单点时各只有一个值，与上面的同名字段一致
+    ::std::vector<::bp_decoder::BpDecoder::Method> bp_methods;
+    ::std::vector<double> bit_error_rates;
+    ::std::vector<int> max_iters;
+    int threads;
+    int batch_lanes;
+    int quant_bits;
+    double llr_scale;
+    bool syndrome_lookup;
+    int flip_steps;
+    bool osd;
+    ::bp_decoder::OsdDecoder::Method osd_method;
+    int osd_order;
+    ::std::string output_path;
+    bool shot_records;
+    ::ErrorSampler::Method sampler;
+    ::ErrorSampler::Engine rng;
+    int target_failures;
+    double ci_relative_width;
+
+public: // utils
+    void codeFromJson(::nlohmann::json const &code)
+    {
+        this->code_family = code.at("family"sv).get<::std::string>();
+        if (this->code_family == "toric"s || this->code_family == "surface"s)
+        {
+            this->code_distance = code.at("distance"sv).get<int>();
+            if (this->code_distance < 2)
+                throw ::std::invalid_argument("code distance must be at least 2."s);
+        }
+        else if (this->code_family == "hgp"s)
+        {
+            this->code_h1 = code.at("h1"sv).get<::std::string>();
+            this->code_h2 = code.value("h2"s, this->code_h1);
+        }
+        else if (this->code_family == "bicycle"s)
+        {
+            this->code_size = code.at("size"sv).get<int>();
+            if (this->code_size <= 0)
+                throw ::std::invalid_argument("code size must be positive."s);
+            this->code_a = code.at("a"sv).get<::std::vector<uint32_t>>();
+            this->code_b = code.at("b"sv).get<::std::vector<uint32_t>>();
+        }
+        else
+            throw ::std::invalid_argument("Unknown code family: "s + this->code_family);
+
+        auto const checks = code.value("checks"s, "x"s);
+        if (checks != "x"s && checks != "z"s)
+            throw ::std::invalid_argument("code checks must be \"x\" or \"z\"."s);
+        this->code_z_checks = checks == "z"s;
+    }
+    ::nlohmann::json codeToJson() const
+    {
+        ::nlohmann::json code{{"family"sv, this->code_family}, {"checks"sv, this->code_z_checks ? "z"sv : "x"sv}};
+        if (this->code_family == "hgp"s)
+        {
+            code["h1"] = this->code_h1;
+            code["h2"] = this->code_h2;
+        }
+        else if (this->code_family == "bicycle"s)
+        {
+            code["size"] = this->code_size;
+            code["a"] = this->code_a;
+            code["b"] = this->code_b;
+        }
+        else
+            code["distance"] = this->code_distance;
+        return code;
+    }
+    static ::bp_decoder::BpDecoder::Method methodFromName(::std::string const &name)
+    {
+        if (name == "min_sum"s)
+            return ::bp_decoder::BpDecoder::Method::MIN_SUM;
+        if (name == "product_sum"s)
+            return ::bp_decoder::BpDecoder::Method::PRODUCT_SUM;
+        if (name == "quantized_min_sum"s)
+            return ::bp_decoder::BpDecoder::Method::QUANTIZED_MIN_SUM;
+        throw ::std::invalid_argument("Unknown bp_method: "s + name);
+    }
+    static ::bp_decoder::BpDecoder::Schedule scheduleFromName(::std::string const &name)
+    {
+        if (name == "flooding"s)
+            return ::bp_decoder::BpDecoder::Schedule::FLOODING;
+        if (name == "layered"s)
+            return ::bp_decoder::BpDecoder::Schedule::LAYERED;
+        throw ::std::invalid_argument("Unknown schedule: "s + name);
+    }
+    // "none" 表示不启用 OSD 后处理
+    static bool osdFromName(::std::string const &name, ::bp_decoder::OsdDecoder::Method &method)
+    {
+        if (name == "none"s)
+            return false;
+        if (name == "osd_0"s)
+            method = ::bp_decoder::OsdDecoder::Method::OSD_0;
+        else if (name == "osd_e"s)
+            method = ::bp_decoder::OsdDecoder::Method::OSD_E;
+        else if (name == "osd_cs"s)
+            method = ::bp_decoder::OsdDecoder::Method::OSD_CS;
+        else
+            throw ::std::invalid_argument("Unknown osd_method: "s + name);
+        return true;
+    }
+    static ::std::string_view osdName(bool osd, ::bp_decoder::OsdDecoder::Method method)
+    {
+        if (!osd)
+            return "none"sv;
+        switch (method)
+        {
+        case ::bp_decoder::OsdDecoder::Method::OSD_0:
+            return "osd_0"sv;
+        case ::bp_decoder::OsdDecoder::Method::OSD_E:
+            return "osd_e"sv;
+        default:
+            return "osd_cs"sv;
+        }
+    }
+    static ::ErrorSampler::Method samplerFromName(::std::string const &name)
+    {
+        if (name == "geometric"s)
+            return ::ErrorSampler::Method::GEOMETRIC;
+        if (name == "bernoulli"s)
+            return ::ErrorSampler::Method::BERNOULLI;
+        throw ::std::invalid_argument("Unknown sampler: "s + name);
+    }
+    static ::ErrorSampler::Engine rngFromName(::std::string const &name)
+    {
+        if (name == "xoshiro256ss"s)
+            return ::ErrorSampler::Engine::XOSHIRO256SS;
+        if (name == "mt19937"s)
+            return ::ErrorSampler::Engine::MT19937;
+        throw ::std::invalid_argument("Unknown rng: "s + name);
+    }
+    static ::std::string_view scheduleName(::bp_decoder::BpDecoder::Schedule schedule)
+    {
+        return schedule == ::bp_decoder::BpDecoder::Schedule::FLOODING ? "flooding"sv : "layered"sv;
+    }
+    static ::std::string_view methodName(::bp_decoder::BpDecoder::Method method)
+    {
+        switch (method)
+        {
+        case ::bp_decoder::BpDecoder::Method::MIN_SUM:
+            return "min_sum"sv;
+        case ::bp_decoder::BpDecoder::Method::PRODUCT_SUM:
+            return "product_sum"sv;
+        default:
+            return "quantized_min_sum"sv;
+        }
+    }
+
+    // 扫描字段的取值：单个值、列表，或范围 {"start", "stop", "step"}（含端点）
+    // 及 {"start", "stop", "num", "log"}（num 个点，log 为 true 时按对数等分）
+    template <typename T>
+    static ::std::vector<T> sweepValues(::nlohmann::json const &json)
+    {
+        ::std::vector<T> values;
+        auto const push = [&values](double value)
+        {
+            if constexpr (::std::is_integral_v<T>)
+                values.push_back(static_cast<T>(::std::llround(value)));
+            else if constexpr (::std::is_arithmetic_v<T>)
+                values.push_back(static_cast<T>(value));
+            else
+                throw ::std::invalid_argument("Ranges require a numeric field."s);
+        };
+        if (json.is_array())
+        {
+            for (auto const &item : json)
+                values.push_back(item.get<T>());
+        }
+        else if (!json.is_object())
+            values.push_back(json.get<T>());
+        else if (json.contains("num"sv))
+        {
+            auto const start{json.at("start"sv).get<double>()}, stop{json.at("stop"sv).get<double>()};
+            auto const num{json.at("num"sv).get<int>()};
+            auto const log{json.value("log"s, false)};
+            if (num < 1)
+                throw ::std::invalid_argument("Range num must be positive."s);
+            if (log && !(start > 0 && stop > 0))
+                throw ::std::invalid_argument("Log range bounds must be positive."s);
+            for (auto k{0}; k < num; k++)
+            {
+                auto const t{num == 1 ? 0. : static_cast<double>(k) / (num - 1)};
+                push(log ? start * ::std::pow(stop / start, t) : start + (stop - start) * t);
+            }
+        }
+        else
+        {
+            auto const start{json.at("start"sv).get<double>()}, stop{json.at("stop"sv).get<double>()};
+            auto const step{json.at("step"sv).get<double>()};
+            if (!(step > 0))
+                throw ::std::invalid_argument("Range step must be positive."s);
+            for (auto k{0}; start + k * step <= stop + step * 1e-9; k++)
+                push(start + k * step);
+        }
+        if (values.empty())
+            throw ::std::invalid_argument("Sweep has no values."s);
+        return values;
+    }
 
 public: // apis
+    // 展开为各仿真点的配置，顺序为 bp_method、max_iter、bit_error_rate 由外到内
+    ::std::vector<Config> points() const
+    {
+        ::std::vector<Config> result;
+        for (auto method : this->bp_methods)
+            for (auto iter : this->max_iters)
+                for (auto rate : this->bit_error_rates)
+                {
+                    Config point{*this};
+                    point.bp_method = method;
+                    point.max_iter = iter;
+                    point.bit_error_rate = rate;
+                    point.bp_methods = {method};
+                    point.max_iters = {iter};
+                    point.bit_error_rates = {rate};
+                    result.push_back(::std::move(point));
+                }
+        return result;
+    }
     auto &from_json(::std::string const &config_file)
     {
         try
@@ -80,18 +490,104 @@ public: // apis
             auto input_targetruns = json.at("target_runs"sv).get<int>();
             this->target_runs = input_targetruns;
 
-            auto input_bpmethod = json.at("bp_method"sv).get<::std::string>();
-            this->bp_method = input_bpmethod == "min_sum"s ? bp_decoder::BpDecoder::Method::MIN_SUM
-                                                           : bp_decoder::BpDecoder::Method::PRODUCT_SUM;
+            // 可选字段，错误采样方式与随机数引擎；bernoulli + mt19937 与旧版本的错误序列一致
+            this->sampler = samplerFromName(json.value("sampler"s, "geometric"s));
+            this->rng = rngFromName(json.value("rng"s, "xoshiro256ss"s));
+
+            // 可选字段，提前停止条件，0 表示不启用；此时 target_runs 为仿真次数上限
+            this->target_failures = json.value("target_failures"s, 0);
+            this->ci_relative_width = json.value("ci_relative_width"s, 0.);
+            if (this->target_failures < 0 || this->ci_relative_width < 0)
+                throw ::std::invalid_argument("target_failures and ci_relative_width must be non-negative."s);
+
+            // bp_method、bit_error_rate、max_iter 均可为列表或范围，见 sweepValues
+            this->bp_methods.clear();
+            for (auto const &input_bpmethod : sweepValues<::std::string>(json.at("bp_method"sv)))
+                this->bp_methods.push_back(methodFromName(input_bpmethod));
+            this->bp_method = this->bp_methods.front();
+
+            // 可选字段，缺省为 flooding
+            auto input_schedule = json.value("schedule"s, "flooding"s);
+            this->schedule = scheduleFromName(input_schedule);
 
-            auto input_biterrorrate = json.at("bit_error_rate"sv).get<double>();
-            this->bit_error_rate = input_biterrorrate;
+            // 可选字段，仅 quantized_min_sum 使用
+            this->quant_bits = json.value("quant_bits"s, 8);
+            this->llr_scale = json.value("llr_scale"s, 4.);
 
-            auto input_maxiter = json.at("max_iter"sv).get<int>();
-            this->max_iter = input_maxiter;
+            // 可选字段，是否对重量为 1、2 的校验子查表译码，缺省为 false
+            this->syndrome_lookup = json.value("syndrome_lookup"s, false);
 
-            auto hx_alist = json.at("hx_alist"sv).get<::std::string>();
-            this->hx_alist = hx_alist;
+            // 可选字段，BP 未收敛时的小集合翻转后处理的最大步数，0 表示不启用
+            this->flip_steps = json.value("flip_steps"s, 0);
+            if (this->flip_steps < 0)
+                throw ::std::invalid_argument("flip_steps must be non-negative."s);
+
+            // 可选字段，BP 未收敛时的 OSD 后处理，缺省不启用
+            this->osd = osdFromName(json.value("osd_method"s, "none"s), this->osd_method);
+            this->osd_order = json.value("osd_order"s, 0);
+            if (this->osd_order < 0)
+                throw ::std::invalid_argument("osd_order must be non-negative."s);
+
+            // 可选字段，探测器错误模型，与 hx_alist、hx_graph、code、lx_alist、priors 及 bit_error_rate 均互斥
+            this->dem = json.value("dem"s, ""s);
+            if (!this->dem.empty())
+                for (auto key : {"hx_alist"sv, "hx_graph"sv, "code"sv, "lx_alist"sv, "priors"sv, "bit_error_rate"sv})
+                    if (json.contains(key))
+                        throw ::std::invalid_argument("dem and "s + ::std::string{key} + " are mutually exclusive."s);
+
+            // 可选字段，逐比特错误概率文件，与 bit_error_rate 二选一；此时 bit_error_rate 记为 NaN
+            this->priors = json.value("priors"s, ""s);
+            if (!this->priors.empty() || !this->dem.empty())
+            {
+                if (json.contains("bit_error_rate"sv))
+                    throw ::std::invalid_argument("bit_error_rate and priors are mutually exclusive."s);
+                this->bit_error_rates = {::std::numeric_limits<double>::quiet_NaN()};
+            }
+            else
+                this->bit_error_rates = sweepValues<double>(json.at("bit_error_rate"sv));
+            if (this->priors.empty() && this->dem.empty() && ::std::any_of(this->bit_error_rates.begin(), this->bit_error_rates.end(), [](double rate)
+                                                      { return !(rate > 0 && rate <= 0.5); }))
+                throw ::std::invalid_argument("bit_error_rate must be in (0, 0.5]."s);
+            this->bit_error_rate = this->bit_error_rates.front();
+
+            this->max_iters = sweepValues<int>(json.at("max_iter"sv));
+            this->max_iter = this->max_iters.front();
+
+            // 可选字段，内置码构造，与 hx_alist 二选一
+            if (json.contains("code"sv) && json.contains("hx_alist"sv))
+                throw ::std::invalid_argument("code and hx_alist are mutually exclusive."s);
+            if (json.contains("code"sv))
+                this->codeFromJson(json.at("code"sv));
+            else if (this->dem.empty())
+                this->hx_alist = json.at("hx_alist"sv).get<::std::string>();
+
+            // 可选字段，编译图缓存路径
+            this->hx_graph = json.value("hx_graph"s, ""s);
+
+            // 可选字段，逻辑算符矩阵，用于判定逻辑错误
+            this->lx_alist = json.value("lx_alist"s, ""s);
+
+            // 可选字段，为空时不输出结果文件
+            this->output_path = json.value("output_path"s, ""s);
+            this->shot_records = json.value("shot_records"s, false);
+
+            // 可选字段，非正数表示使用全部硬件线程
+            auto input_threads = json.value("threads"s, 0);
+            this->threads = input_threads > 0 ? input_threads
+                                              : ::std::max(1U, ::std::thread::hardware_concurrency());
+
+            // 可选字段，仅 min_sum 支持 8/16/32 路批量译码，0 表示逐个译码
+            auto input_batchlanes = json.value("batch_lanes"s, 0);
+            if (input_batchlanes != 0 && input_batchlanes != 8 && input_batchlanes != 16 && input_batchlanes != 32)
+                throw ::std::invalid_argument("batch_lanes must be one of 0, 8, 16, 32."s);
+            if (input_batchlanes != 0 && ::std::any_of(this->bp_methods.begin(), this->bp_methods.end(), [](auto method)
+                                                       { return method != bp_decoder::BpDecoder::Method::MIN_SUM; }))
+                throw ::std::invalid_argument("batch_lanes requires bp_method \"min_sum\"."s);
+            if (input_batchlanes != 0 && this->schedule != bp_decoder::BpDecoder::Schedule::FLOODING)
+                throw ::std::invalid_argument("batch_lanes requires schedule \"flooding\"."s);
+            if (input_batchlanes != 0 && (this->osd || this->flip_steps || this->syndrome_lookup))
+                throw ::std::invalid_argument("batch_lanes does not support flip_steps, osd_method or syndrome_lookup."s);
+            this->batch_lanes = input_batchlanes;
         }
         catch (::nlohmann::json::parse_error const &err)
         {
@@ -105,6 +601,18 @@ public: // apis
                         << err.what();
             ::std::exit(1);
         }
+        catch (::nlohmann::json::type_error const &err)
+        {
+            ::std::cerr << "JSON字段类型错误\n\n"sv
+                        << err.what();
+            ::std::exit(1);
+        }
+        catch (::std::invalid_argument const &err)
+        {
+            ::std::cerr << "JSON字段取值无效\n\n"sv
+                        << err.what();
+            ::std::exit(1);
+        }
 
         return *this;
     }
@@ -113,72 +621,678 @@ public: // apis
         return ::nlohmann::json{
             {"random_seed"sv, this->random_seed},
             {"target_runs"sv, this->target_runs},
-            {"bp_method"sv, this->bp_method == bp_decoder::BpDecoder::Method::MIN_SUM ? "min_sum"sv : "product_sum"sv},
+            {"sampler"sv, this->sampler == ::ErrorSampler::Method::GEOMETRIC ? "geometric"sv : "bernoulli"sv},
+            {"rng"sv, this->rng == ::ErrorSampler::Engine::XOSHIRO256SS ? "xoshiro256ss"sv : "mt19937"sv},
+            {"target_failures"sv, this->target_failures},
+            {"ci_relative_width"sv, this->ci_relative_width},
+            {"bp_method"sv, methodName(this->bp_method)},
+            {"schedule"sv, scheduleName(this->schedule)},
             {"bit_error_rate"sv, this->bit_error_rate},
-            {"max_iter"sv, this->max_iter}};
+            {"priors"sv, this->priors},
+            {"dem"sv, this->dem},
+            {"max_iter"sv, this->max_iter},
+            {"threads"sv, this->threads},
+            {"batch_lanes"sv, this->batch_lanes},
+            {"quant_bits"sv, this->quant_bits},
+            {"llr_scale"sv, this->llr_scale},
+            {"syndrome_lookup"sv, this->syndrome_lookup},
+            {"flip_steps"sv, this->flip_steps},
+            {"osd_method"sv, osdName(this->osd, this->osd_method)},
+            {"osd_order"sv, this->osd_order},
+            {"output_path"sv, this->output_path},
+            {"shot_records"sv, this->shot_records},
+            {"code"sv, this->code_family.empty() ? ::nlohmann::json{} : this->codeToJson()}};
     }
 };
 
-class RandBitGen
+// 单次仿真的结果记录，按小端序原样写入 shots.bin
+struct ShotRecord
 {
-    ::std::mt19937 rand_example;
-    uint32_t threshold;
+    enum Flags : uint32_t
+    {
+        ZERO_ERROR = 1,        // 未产生错误，未译码
+        CONVERGED = 2,         // BP 收敛
+        POST_PROCESSED = 4,    // BP 未收敛，由后处理给出译码
+        SYNDROME_FAILURE = 8,  // 译码不满足校验子
+        FRAME_ERROR = 16,      // 译码与错误不一致
+        LOGICAL_ERROR = 32,    // 译码与错误之差不在逻辑算符的核中
+        LOOKED_UP = 64         // 未运行 BP，由查表给出译码
+    };
+    uint64_t shot;
+    uint32_t iter;
+    uint32_t error_weight;
+    uint32_t decoding_weight;
+    uint32_t flags;
+};
+static_assert(sizeof(ShotRecord) == 24);
 
-public:
-    RandBitGen(uint32_t random_seed, double bit_error_rate)
-        : rand_example{random_seed},
-          threshold{static_cast<uint32_t>(bit_error_rate * UINT32_MAX)} {}
-    uint8_t operator()() { return rand_example() < threshold; }
+// 译码统计，每个工作线程一份，结束后合并
+class Statistics
+{
+public: // data
+    uint64_t shots{0}, zero_error{0}, converged{0}, post_processed{0}, looked_up{0}, syndrome_failures{0}, frame_errors{0}, logical_errors{0};
+    // 下标为 BP 迭代次数，最后一格为未收敛；不含未产生错误和查表译码的仿真
+    ::std::vector<uint64_t> iteration_histogram;
+
+public: // apis
+    explicit Statistics(int max_iter = 0) : iteration_histogram(::std::max(max_iter, 0) + 1, 0) {}
+    void add(ShotRecord const &record)
+    {
+        this->shots++;
+        this->zero_error += (record.flags & ShotRecord::ZERO_ERROR) != 0;
+        this->converged += (record.flags & ShotRecord::CONVERGED) != 0;
+        this->post_processed += (record.flags & ShotRecord::POST_PROCESSED) != 0;
+        this->looked_up += (record.flags & ShotRecord::LOOKED_UP) != 0;
+        this->syndrome_failures += (record.flags & ShotRecord::SYNDROME_FAILURE) != 0;
+        this->frame_errors += (record.flags & ShotRecord::FRAME_ERROR) != 0;
+        this->logical_errors += (record.flags & ShotRecord::LOGICAL_ERROR) != 0;
+        if (!(record.flags & (ShotRecord::ZERO_ERROR | ShotRecord::LOOKED_UP)))
+            this->iteration_histogram[::std::min<size_t>(record.iter, this->iteration_histogram.size() - 1)]++;
+    }
+    Statistics &operator+=(Statistics const &that)
+    {
+        this->shots += that.shots;
+        this->zero_error += that.zero_error;
+        this->converged += that.converged;
+        this->post_processed += that.post_processed;
+        this->looked_up += that.looked_up;
+        this->syndrome_failures += that.syndrome_failures;
+        this->frame_errors += that.frame_errors;
+        this->logical_errors += that.logical_errors;
+        for (auto i{0ULL}; i < this->iteration_histogram.size(); i++)
+            this->iteration_histogram[i] += that.iteration_histogram[i];
+        return *this;
+    }
+    auto to_json() const
+    {
+        auto const rate = [this](uint64_t count)
+        { return this->shots ? static_cast<double>(count) / this->shots : 0.; };
+        return ::nlohmann::json{
+            {"shots"sv, this->shots},
+            {"zero_error"sv, this->zero_error},
+            {"converged"sv, this->converged},
+            {"post_processed"sv, this->post_processed},
+            {"looked_up"sv, this->looked_up},
+            {"syndrome_failures"sv, this->syndrome_failures},
+            {"syndrome_failure_rate"sv, rate(this->syndrome_failures)},
+            {"frame_errors"sv, this->frame_errors},
+            {"frame_error_rate"sv, rate(this->frame_errors)},
+            {"logical_errors"sv, this->logical_errors},
+            {"logical_error_rate"sv, rate(this->logical_errors)},
+            {"iteration_histogram"sv, this->iteration_histogram}};
+    }
 };
 
+// 后台写线程：工作线程按批次整块提交记录，写线程顺序落盘，译码线程不直接做 I/O
+class RecordWriter
+{
+private: // consts
+    // 积压的批次数上限，超过时提交方等待，避免写盘跟不上时内存无限增长
+    static constexpr size_t max_pending{64};
+
+private: // vars
+    ::std::filesystem::path path;
+    ::std::ofstream stream;
+    ::std::mutex mutex;
+    ::std::condition_variable_any changed;
+    ::std::deque<::std::vector<ShotRecord>> pending;
+    bool failed; // 某次写入失败，此后的记录直接丢弃，由 close() 报告
+    ::std::jthread thread; // 最后析构：先请求停止并写完积压的记录，其余成员仍然有效
+
+private: // utils
+    void loop(::std::stop_token token)
+    {
+        ::std::unique_lock lock{this->mutex};
+        while (true)
+        {
+            this->changed.wait(lock, token, [this]()
+                               { return !this->pending.empty(); });
+            if (this->pending.empty())
+                return; // 已请求停止且没有积压
+            auto records{::std::move(this->pending.front())};
+            this->pending.pop_front();
+            lock.unlock();
+            this->changed.notify_all();
+            this->stream.write(reinterpret_cast<char const *>(records.data()),
+                               static_cast<::std::streamsize>(records.size() * sizeof(ShotRecord)));
+            lock.lock();
+            if (!this->stream)
+            {
+                this->failed = true;
+                this->pending.clear();
+                this->changed.notify_all();
+            }
+        }
+    }
+
+public: // apis
+    explicit RecordWriter(::std::filesystem::path const &path)
+        : path{path}, stream{path, ::std::ios::binary}, failed{false}
+    {
+        if (!this->stream)
+            throw ::std::runtime_error("Could not create file: "s + path.string());
+        this->thread = ::std::jthread{[this](::std::stop_token token)
+                                      { this->loop(token); }};
+    }
+    void submit(::std::vector<ShotRecord> &&records)
+    {
+        ::std::unique_lock lock{this->mutex};
+        this->changed.wait(lock, [this]()
+                           { return this->pending.size() < max_pending; });
+        if (this->failed)
+            return;
+        this->pending.push_back(::std::move(records));
+        lock.unlock();
+        this->changed.notify_all();
+    }
+    // 等待积压的记录落盘并关闭文件，写线程中的任何写入失败都在这里抛出
+    void close()
+    {
+        this->thread.request_stop();
+        this->thread.join();
+        this->stream.close();
+        if (this->failed || !this->stream)
+            throw ::std::runtime_error("Could not write file: "s + this->path.string());
+    }
+};
+
+// 常驻线程池：整个扫描只创建一次。每个仿真点在所有线程上各运行一次 job(id)，主线程作为 0 号参与，
+// 全部返回后才进入下一个点
+class WorkerPool
+{
+private: // vars
+    ::std::mutex mutex;
+    ::std::condition_variable_any changed;
+    ::std::function<void(size_t)> job;
+    uint64_t generation; // 已发布的任务数
+    size_t running;      // 本轮尚未完成的后台线程数
+    ::std::exception_ptr error;
+    ::std::vector<::std::jthread> threads; // 最后析构：先请求停止并等待线程退出，其余成员仍然有效
+
+private: // utils
+    // 运行 job，异常只保留第一个，由 run() 在主线程重新抛出
+    void execute(size_t id)
+    {
+        try
+        {
+            this->job(id);
+        }
+        catch (...)
+        {
+            ::std::lock_guard lock{this->mutex};
+            if (!this->error)
+                this->error = ::std::current_exception();
+        }
+    }
+    void loop(::std::stop_token token, size_t id)
+    {
+        uint64_t seen{0};
+        ::std::unique_lock lock{this->mutex};
+        while (this->changed.wait(lock, token, [this, &seen]()
+                                  { return this->generation != seen; }))
+        {
+            seen = this->generation;
+            lock.unlock();
+            this->execute(id);
+            lock.lock();
+            if (--this->running == 0)
+                this->changed.notify_all();
+        }
+    }
+
+public: // apis
+    explicit WorkerPool(size_t size) : generation{0}, running{0}
+    {
+        for (auto id{1ULL}; id < size; id++)
+            this->threads.emplace_back([this, id](::std::stop_token token)
+                                       { this->loop(token, id); });
+    }
+    size_t size() const { return this->threads.size() + 1; }
+    // 在每个线程上运行一次 job 并等待全部完成，任一线程抛出的异常在此重新抛出
+    void run(::std::function<void(size_t)> job)
+    {
+        {
+            ::std::lock_guard lock{this->mutex};
+            this->job = ::std::move(job);
+            this->running = this->threads.size();
+            this->generation++;
+        }
+        this->changed.notify_all();
+        this->execute(0);
+        ::std::unique_lock lock{this->mutex};
+        this->changed.wait(lock, [this]()
+                           { return this->running == 0; });
+        if (auto error{::std::exchange(this->error, nullptr)})
+            ::std::rethrow_exception(error);
+    }
+};
+
+// 二项比例 failures / shots 的 Wilson 置信区间，z 为正态分位数
+static ::std::pair<double, double> wilsonInterval(uint64_t failures, uint64_t shots, double z = 1.96)
+{
+    if (shots == 0)
+        return {0., 1.};
+    double const n = shots, p = failures / n, z2 = z * z;
+    auto const center{(p + z2 / (2 * n)) / (1 + z2 / n)};
+    auto const half{z * ::std::sqrt(p * (1 - p) / n + z2 / (4 * n * n)) / (1 + z2 / n)};
+    return {::std::max(0., center - half), ::std::min(1., center + half)};
+}
+
 class Test
 {
+private: // consts
+    // 每个批次使用独立的随机数流，由工作线程动态领取
+    static constexpr uint64_t batch_size{1024};
+
+private: // types
+    // 各工作线程共享的计数器。每个批次结束时累加一次并检查停止条件，满足时置位 stop，
+    // 其余线程做完手头的批次后不再领取新批次，不需要任何等待
+    struct Counters
+    {
+        ::std::atomic<uint64_t> next_batch{0}, shots{0}, failures{0};
+        ::std::atomic<bool> stop{false};
+    };
+    // 单个工作线程的输出：统计量以及（启用时）逐次记录的去向
+    struct Sink
+    {
+        ::Statistics statistics;
+        ::RecordWriter *writer;
+        ::std::vector<ShotRecord> records;
+        // 计为失败的标志位：指定逻辑算符时为逻辑错误，否则为译码错误
+        uint32_t failure_flag;
+        uint64_t batch_shots{0}, batch_failures{0};
+
+        void add(ShotRecord const &record)
+        {
+            this->statistics.add(record);
+            this->batch_shots++;
+            this->batch_failures += (record.flags & this->failure_flag) != 0;
+            if (this->writer)
+                this->records.push_back(record);
+        }
+        // 每个批次结束时整块提交给写线程
+        void flush()
+        {
+            if (this->writer && !this->records.empty())
+            {
+                this->writer->submit(::std::move(this->records));
+                this->records = {};
+                this->records.reserve(batch_size);
+            }
+        }
+    };
+
+    // 工作线程跨仿真点保留的译码器。bp_method 或 max_iter 变化时重建，只有错误率变化时仅更新信道 LLR，
+    // 查表等预处理得以复用
+    struct Worker
+    {
+        ::std::variant<::std::monostate, ::bp_decoder::BpDecoder, ::bp_decoder::BatchBpDecoder<8>,
+                       ::bp_decoder::BatchBpDecoder<16>, ::bp_decoder::BatchBpDecoder<32>>
+            decoder;
+        ::bp_decoder::BpDecoder::Method bp_method;
+        int max_iter;
+    };
+
 private: // vars
-    ::RandBitGen randBitGen;
-    ::bp_decoder::BpDecoder bpDecoder;
-    int target_runs;
+    ::Config config;
     ::sparse_matrix::Mod2SparseMatrix hx;
-
-    ::std::vector<uint8_t> bit_error;
+    ::sparse_matrix::Mod2SparseMatrix lx; // 未指定时为 0 行
+    // 逐比特错误概率及其 LLR，未指定 priors 或 dem 时为空
+    ::std::vector<double> priors, prior_llrs;
+    double prior_max;
 
 private: // utils
-    // 返回是否生成了错误
-    bool generateError(::std::vector<uint8_t> &arr)
+    static ::sparse_matrix::Mod2SparseMatrix buildCode(::Config const &config)
     {
-        bool has_error = false;
-        for (auto &item : arr)
+        ::sparse_matrix::CssCode code;
+        if (config.code_family == "toric"s)
+            code = ::sparse_matrix::toricCode(config.code_distance);
+        else if (config.code_family == "surface"s)
+            code = ::sparse_matrix::surfaceCode(config.code_distance);
+        else if (config.code_family == "hgp"s)
+            code = ::sparse_matrix::hypergraphProduct(::sparse_matrix::Mod2SparseMatrix::fromAlist(config.code_h1),
+                                                      ::sparse_matrix::Mod2SparseMatrix::fromAlist(config.code_h2));
+        else
+            code = ::sparse_matrix::generalizedBicycle(config.code_size, config.code_a, config.code_b);
+        return config.code_z_checks ? code.hz : code.hx;
+    }
+    // 编译图缓存的来源指纹：hx_alist 的内容，或码构造参数连同其引用的 alist 内容
+    static uint64_t graphSource(::Config const &config)
+    {
+        auto const read = [](::std::string const &path)
         {
-            item = randBitGen();
-            has_error |= item;
+            ::std::ifstream file{path, ::std::ios::binary};
+            if (!file)
+                throw ::std::runtime_error("Could not open file: "s + path);
+            return ::std::string(::std::istreambuf_iterator<char>{file}, ::std::istreambuf_iterator<char>{});
+        };
+        if (config.code_family.empty())
+            return ::sparse_matrix::Mod2SparseMatrix::fingerprint(read(config.hx_alist));
+        auto source{config.codeToJson().dump()};
+        if (config.code_family == "hgp"s)
+            source += '\0' + read(config.code_h1) + '\0' + read(config.code_h2);
+        return ::sparse_matrix::Mod2SparseMatrix::fingerprint(source);
+    }
+    // 若指定了编译图缓存、文件存在且来源指纹一致则直接映射，否则解析 alist 或构造码并重写缓存
+    static auto loadMatrix(::Config const &config)
+    {
+        auto const source{config.hx_graph.empty() ? 0 : graphSource(config)};
+        if (!config.hx_graph.empty() && ::std::filesystem::exists(config.hx_graph) &&
+            ::sparse_matrix::Mod2SparseMatrix::sourceOf(config.hx_graph) == source)
+            return ::sparse_matrix::Mod2SparseMatrix::load(config.hx_graph);
+        auto matrix{config.code_family.empty() ? ::sparse_matrix::Mod2SparseMatrix::fromAlist(config.hx_alist)
+                                               : buildCode(config)};
+        if (!config.hx_graph.empty())
+            matrix.save(config.hx_graph, source);
+        return matrix;
+    }
+    // 每行或以空白分隔的一列错误概率，个数须与校验矩阵列数相同
+    static ::std::vector<double> loadPriors(::std::string const &path, size_t cols)
+    {
+        ::std::ifstream file{path};
+        if (!file)
+            throw ::std::runtime_error("Could not open priors file."s);
+        ::std::vector<double> priors;
+        for (double p; file >> p;)
+            priors.push_back(p);
+        if (!file.eof())
+            throw ::std::runtime_error("Invalid number in priors file."s);
+        if (priors.size() != cols)
+            throw ::std::runtime_error("Priors length mismatch check matrix col."s);
+        return priors;
+    }
+    // 抽样与译码所用的错误概率；逐比特概率时为其最大值
+    double errorRate(::Config const &config) const
+    {
+        return this->priors.empty() ? config.bit_error_rate : this->prior_max;
+    }
+    // 领取下一个批次，已满足停止条件或批次用尽时返回 false
+    bool nextBatch(::Config const &config, Counters &counters, uint64_t &batch) const
+    {
+        if (counters.stop.load(::std::memory_order_relaxed))
+            return false;
+        batch = counters.next_batch.fetch_add(1, ::std::memory_order_relaxed);
+        return batch < batchCount(config);
+    }
+    static bool shouldStop(::Config const &config, uint64_t shots, uint64_t failures)
+    {
+        if (config.target_failures > 0 && failures >= static_cast<uint64_t>(config.target_failures))
+            return true;
+        if (config.ci_relative_width > 0 && failures > 0)
+        {
+            auto const [lower, upper] = wilsonInterval(failures, shots);
+            return (upper - lower) * shots / failures <= config.ci_relative_width;
+        }
+        return false;
+    }
+    // 批次结束：提交记录，累加全局计数并检查停止条件
+    void finishBatch(::Config const &config, Counters &counters, Sink &sink) const
+    {
+        sink.flush();
+        auto const shots{counters.shots.fetch_add(sink.batch_shots, ::std::memory_order_relaxed) + sink.batch_shots};
+        auto const failures{counters.failures.fetch_add(sink.batch_failures, ::std::memory_order_relaxed) + sink.batch_failures};
+        sink.batch_shots = sink.batch_failures = 0;
+        if (shouldStop(config, shots, failures))
+            counters.stop.store(true, ::std::memory_order_relaxed);
+    }
+    static uint64_t batchCount(::Config const &config)
+    {
+        uint64_t const target_runs = ::std::max(config.target_runs, 0);
+        return (target_runs + batch_size - 1) / batch_size;
+    }
+    static uint64_t batchRuns(::Config const &config, uint64_t batch)
+    {
+        uint64_t const target_runs = ::std::max(config.target_runs, 0);
+        return ::std::min(batch_size, target_runs - batch * batch_size);
+    }
+
+    // 取出本线程可复用的译码器，必要时按当前仿真点重建
+    template <typename Decoder>
+    Decoder &prepare(::Config const &config, Worker &worker) const
+    {
+        auto *const reusable{::std::get_if<Decoder>(&worker.decoder)};
+        if (reusable && worker.bp_method == config.bp_method && worker.max_iter == config.max_iter)
+        {
+            if (this->priors.empty())
+                reusable->setErrorProb(config.bit_error_rate);
+            return *reusable;
+        }
+        worker.bp_method = config.bp_method;
+        worker.max_iter = config.max_iter;
+        if constexpr (::std::is_same_v<Decoder, ::bp_decoder::BpDecoder>)
+        {
+            auto &decoder{worker.decoder.emplace<Decoder>(this->hx, config.bp_method, this->errorRate(config), config.max_iter, config.schedule)};
+            if (!this->priors.empty())
+                decoder.setPriorLlrs(this->prior_llrs);
+            if (config.bp_method == ::bp_decoder::BpDecoder::Method::QUANTIZED_MIN_SUM)
+                decoder.setQuantization(config.quant_bits, config.llr_scale);
+            if (config.syndrome_lookup)
+                decoder.setSyndromeLookup(true);
+            if (config.flip_steps)
+                decoder.setFlip(config.flip_steps);
+            if (config.osd)
+                decoder.setOsd(config.osd_method, config.osd_order);
+            return decoder;
+        }
+        else
+        {
+            auto &decoder{worker.decoder.emplace<Decoder>(this->hx, this->errorRate(config), config.max_iter)};
+            if (!this->priors.empty())
+                decoder.setPriorLlrs(this->prior_llrs);
+            return decoder;
+        }
+    }
+    // 逐个译码，每个线程独占译码器工作区和缓冲区
+    void simulate(::Config const &config, Counters &counters, Sink &sink, Worker &worker) const
+    {
+        auto &bpDecoder{this->prepare<::bp_decoder::BpDecoder>(config, worker)};
+        ::sparse_matrix::Mod2Vector bit_error(this->hx.cols()), syndrome(this->hx.rows()), decoded(this->hx.cols()), logical(this->lx.rows());
+        for (uint64_t batch; this->nextBatch(config, counters, batch);)
+        {
+            ::ErrorSampler sampleError{config.sampler, config.rng, static_cast<uint32_t>(config.random_seed), batch, this->errorRate(config), this->priors};
+            for (uint64_t curr{0}, runs{batchRuns(config, batch)}; curr < runs; curr++)
+            {
+                ShotRecord record{batch * batch_size + curr, 0, 0, 0, ShotRecord::ZERO_ERROR};
+                auto has_error = sampleError(bit_error);
+                if (has_error)
+                {
+                    this->hx.multiply(bit_error, syndrome);
+                    auto [run_iter, converge, log_prob_ratios, bp_decoding, post_processed, looked_up] = bpDecoder.decode(syndrome);
+                    decoded.assign(bp_decoding);
+                    record = this->judge(record.shot, run_iter, converge, post_processed, looked_up, bit_error, decoded, logical);
+                }
+                sink.add(record);
+            }
+            this->finishBatch(config, counters, sink);
         }
-        return has_error;
+    }
+    // 每攒满 Lanes 个非零错误的校验子就批量译码一次
+    template <size_t Lanes>
+    void simulateLanes(::Config const &config, Counters &counters, Sink &sink, Worker &worker) const
+    {
+        auto &bpDecoder{this->prepare<::bp_decoder::BatchBpDecoder<Lanes>>(config, worker)};
+        auto const rows{this->hx.rows()}, cols{this->hx.cols()};
+        ::sparse_matrix::Mod2Vector bit_error(cols), syndrome(rows), decoded(cols), logical(this->lx.rows());
+        ::std::vector<uint8_t> syndromes(rows * Lanes);
+        // 每个通道对应的仿真编号和错误，译码后用于判定
+        ::std::vector<uint64_t> shots(Lanes);
+        ::std::vector<::sparse_matrix::Mod2Vector> bit_errors(Lanes, ::sparse_matrix::Mod2Vector(cols));
+        for (uint64_t batch; this->nextBatch(config, counters, batch);)
+        {
+            ::ErrorSampler sampleError{config.sampler, config.rng, static_cast<uint32_t>(config.random_seed), batch, this->errorRate(config), this->priors};
+            auto pending{0ULL};
+            auto flush = [&]()
+            {
+                auto [run_iters, converges, bp_decodings] = bpDecoder.decode(syndromes, pending);
+                for (auto l{0ULL}; l < pending; l++)
+                {
+                    decoded.assign(bp_decodings.subspan(l * cols, cols));
+                    sink.add(this->judge(shots[l], run_iters[l], converges[l], false, false, bit_errors[l], decoded, logical));
+                }
+                pending = 0;
+            };
+            for (uint64_t curr{0}, runs{batchRuns(config, batch)}; curr < runs; curr++)
+            {
+                auto has_error = sampleError(bit_error);
+                if (!has_error)
+                    sink.add({batch * batch_size + curr, 0, 0, 0, ShotRecord::ZERO_ERROR});
+                else
+                {
+                    this->hx.multiply(bit_error, syndrome);
+                    if (!syndrome.any())
+                    {
+                        // 校验子为零时全零译码即收敛，不占用通道
+                        decoded.clear();
+                        sink.add(this->judge(batch * batch_size + curr, 0, true, false, false, bit_error, decoded, logical));
+                        continue;
+                    }
+                    syndrome.toBytes(::std::span{syndromes}.subspan(pending * rows, rows));
+                    shots[pending] = batch * batch_size + curr;
+                    bit_errors[pending] = bit_error;
+                    if (++pending == Lanes)
+                        flush();
+                }
+            }
+            if (pending)
+                flush();
+            this->finishBatch(config, counters, sink);
+        }
+    }
+    // 判定一次译码。BP 在未收敛时给出的译码必然不满足校验子，后处理和查表只在满足时才被采用
+    // decoded 会被改写为 bit_error ^ decoded，逻辑判定为 L * (bit_error ^ decoded) 是否非零
+    ShotRecord judge(uint64_t shot, size_t iter, bool converge, bool post_processed, bool looked_up,
+                     ::sparse_matrix::Mod2Vector const &bit_error, ::sparse_matrix::Mod2Vector &decoded,
+                     ::sparse_matrix::Mod2Vector &logical) const
+    {
+        auto const decoding_weight{decoded.weight()};
+        uint32_t flags{0};
+        if (converge)
+            flags |= ShotRecord::CONVERGED;
+        if (post_processed)
+            flags |= ShotRecord::POST_PROCESSED;
+        if (looked_up)
+            flags |= ShotRecord::LOOKED_UP;
+        if (!converge && !post_processed && !looked_up)
+            flags |= ShotRecord::SYNDROME_FAILURE;
+        decoded ^= bit_error;
+        if (decoded.any())
+            flags |= ShotRecord::FRAME_ERROR;
+        if (this->lx.rows())
+        {
+            this->lx.multiply(decoded, logical);
+            if (logical.any())
+                flags |= ShotRecord::LOGICAL_ERROR;
+        }
+        return {shot, static_cast<uint32_t>(iter), static_cast<uint32_t>(bit_error.weight()),
+                static_cast<uint32_t>(decoding_weight), flags};
+    }
+
+    // 仿真单个参数组合，返回其统计和汇总
+    ::std::pair<::Statistics, ::nlohmann::json> runPoint(::Config const &config, ::std::string const &records_path,
+                                                         ::WorkerPool &pool, ::std::vector<Worker> &workers)
+    {
+        auto const start{::std::chrono::steady_clock::now()};
+        ::std::optional<::RecordWriter> writer;
+        if (!records_path.empty() && config.shot_records)
+            writer.emplace(records_path);
+
+        Counters counters;
+        auto const failure_flag{this->lx.rows() ? ShotRecord::LOGICAL_ERROR : ShotRecord::FRAME_ERROR};
+        ::std::vector<Sink> sinks(pool.size(), Sink{::Statistics{config.max_iter}, writer ? &*writer : nullptr, {}, failure_flag});
+        auto job = [this, &config, &counters, &sinks, &workers](size_t id)
+        {
+            auto &sink{sinks[id]};
+            auto &worker{workers[id]};
+            switch (config.batch_lanes)
+            {
+            case 8:
+                return this->simulateLanes<8>(config, counters, sink, worker);
+            case 16:
+                return this->simulateLanes<16>(config, counters, sink, worker);
+            case 32:
+                return this->simulateLanes<32>(config, counters, sink, worker);
+            default:
+                return this->simulate(config, counters, sink, worker);
+            }
+        };
+        pool.run(job);
+        if (writer)
+            writer->close(); // 等待写线程落盘
+
+        ::Statistics total{config.max_iter};
+        for (auto const &sink : sinks)
+            total += sink.statistics;
+        auto summary = total.to_json();
+        auto const failures{counters.failures.load()};
+        auto const [lower, upper] = wilsonInterval(failures, total.shots);
+        summary["failures"] = failures;
+        summary["failure_rate_interval"] = {lower, upper};
+        summary["stopped_early"] = counters.stop.load() && total.shots < static_cast<uint64_t>(::std::max(config.target_runs, 0));
+        summary["config"] = config.to_json();
+        summary["running_time"] = ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - start).count();
+        return {::std::move(total), ::std::move(summary)};
     }
 
 public: // apis
     Test(::Config const &config)
-        : randBitGen{static_cast<uint32_t>(config.random_seed), config.bit_error_rate},
-          bpDecoder{config.bp_method, config.bit_error_rate, config.max_iter},
-          target_runs{config.target_runs}
+        : config{config},
+          hx{config.dem.empty() ? loadMatrix(config) : ::sparse_matrix::Mod2SparseMatrix{}}, prior_max{0}
     {
-        ::std::ifstream{config.hx_alist} >> this->hx;
+        if (!config.dem.empty())
+        {
+            // 每个不同的错误机制为一列，观测量即逻辑算符
+            auto dem{::sparse_matrix::DetectorErrorModel::fromFile(config.dem)};
+            this->hx = ::std::move(dem.check_matrix);
+            this->lx = ::std::move(dem.observables);
+            this->priors = ::std::move(dem.priors);
+        }
+        if (!config.lx_alist.empty())
+        {
+            this->lx = ::sparse_matrix::Mod2SparseMatrix::fromAlist(config.lx_alist);
+            if (this->lx.cols() != this->hx.cols())
+                throw ::std::runtime_error("Logical operator matrix col mismatch check matrix col."s);
+        }
+        if (!config.priors.empty())
+            this->priors = loadPriors(config.priors, this->hx.cols());
+        if (!this->priors.empty())
+        {
+            if (::std::any_of(this->priors.begin(), this->priors.end(), [](double p)
+                              { return !(p > 0 && p <= 0.5); }))
+                throw ::std::runtime_error(config.dem.empty() ? "Priors must be in (0, 0.5]."s
+                                                              : "Detector error model has a mechanism with merged probability above 0.5."s);
+            this->prior_max = *::std::max_element(this->priors.begin(), this->priors.end());
+            for (auto p : this->priors)
+                this->prior_llrs.push_back(::std::log((1 - p) / p));
+        }
         // ::std::cout << this->hx;
-        this->bit_error.resize(hx.col);
-        this->run();
     }
-    void run()
+    // 仿真所有参数组合。各仿真点依次进行，每个点的批次分给整个线程池；矩阵只加载一次，线程池只创建一次
+    ::std::vector<::Statistics> run()
     {
-        auto bp_success_count{0ULL};
-        for (auto curr{0}; curr < target_runs; curr++)
+        ::std::filesystem::path const output_path{this->config.output_path};
+        if (!output_path.empty())
+            ::std::filesystem::create_directories(output_path);
+        auto const points{this->config.points()};
+        ::std::vector<::Statistics> results;
+        auto summary = ::nlohmann::json::array();
+        ::WorkerPool pool{static_cast<size_t>(this->config.threads)};
+        ::std::vector<Worker> workers(pool.size());
+        for (auto i{0ULL}; i < points.size(); i++)
         {
-            auto has_error = this->generateError(bit_error);
-            if (!has_error)
-                bp_success_count++; // treated as succeeded
-            else
-            {
-                auto [run_iter, converge, log_prob_ratios, bp_decoding] = bpDecoder.run(this->hx, this->bit_error);
-                // @todo
-            }
+            // 单点时沿用 shots.bin，扫描时每个点一个记录文件
+            auto const records{points.size() == 1 ? "shots.bin"s : "shots_"s + ::std::to_string(i) + ".bin"s};
+            auto [statistics, point_summary] = this->runPoint(points[i], output_path.empty() ? ""s : (output_path / records).string(), pool, workers);
+            results.push_back(::std::move(statistics));
+            summary.push_back(::std::move(point_summary));
+        }
+        if (!output_path.empty())
+        {
+            ::std::ofstream stream{output_path / "summary.json"s};
+            stream << (points.size() == 1 ? summary[0] : ::nlohmann::json{{"points"sv, summary}}).dump(4);
+            if (!stream)
+                throw ::std::runtime_error("Could not write file: "s + (output_path / "summary.json"s).string());
         }
+        return results;
     }
 };
 
@@ -204,10 +1318,19 @@ int main(int argc, char *argv[])
 {
     auto config = parseCommandLine(argc, argv);
 
-    ::Test test(config);
-    auto duration = timeit([&test]()
-                           { test.run(); });
-    ::std::cout << "Sim running time: "sv << duration;
+    try
+    {
+        ::Test test(config);
+        auto duration = timeit([&test]()
+                               { test.run(); });
+        ::std::cout << "Sim running time: "sv << duration;
+    }
+    catch (::std::exception const &err)
+    {
+        ::std::cerr << "仿真失败\n\n"sv
+                    << err.what();
+        return 1;
+    }
 
     return 0;
 }
\ No newline at end of file